@@ -1,6 +1,54 @@
 #ifndef COMMON_TYPES_H
 #define COMMON_TYPES_H
 
-// Your type definitions and declarations here
+#include <stdint.h>
 
-#endif // COMMON_TYPES_H
\ No newline at end of file
+// Shared vision types. Kept free of ESP-IDF headers so the vision core
+// can also be compiled on the host.
+
+// Pixel-valued settings (steering set point, standoff width, minimum blob
+// area) are given for a QVGA frame and scaled to the frame actually captured,
+// so they hold when the camera governor changes the resolution
+#define REF_FRAME_WIDTH 320
+#define REF_FRAME_HEIGHT 240
+#define REF_FRAME_PIXELS (REF_FRAME_WIDTH * REF_FRAME_HEIGHT)
+
+typedef struct {
+    uint8_t h;
+    uint8_t s;
+    uint8_t v;
+} hsv_pixel_t;
+
+typedef struct {
+    uint8_t min;
+    uint8_t max;
+} h_range_t;
+
+typedef struct {
+    int x;
+    int y;
+} point_t;
+
+typedef struct {
+    // The "Centroid" (for steering)
+    point_t centroid;
+
+    // The "Bounding Box" (for visualizing or collision logic)
+    point_t top_left;     // Upper Left point
+    point_t bottom_right; // Lower Right point
+
+    // The "Mass" (for distance estimation)
+    uint32_t area;     // Total number of valid pixels
+} color_blob_t;
+
+// Define color ranges in HSV space
+static const h_range_t COLOR_RED   = { .min = 170,   .max = 10  };
+
+static const h_range_t COLOR_ORANGE    = { .min = 11,  .max = 25  };
+static const h_range_t COLOR_YELLOW    = { .min = 26,  .max = 34  };
+static const h_range_t COLOR_GREEN     = { .min = 35,  .max = 85  };
+static const h_range_t COLOR_CYAN      = { .min = 86,  .max = 99  };
+static const h_range_t COLOR_BLUE      = { .min = 100, .max = 130 };
+static const h_range_t COLOR_PURPLE    = { .min = 131, .max = 169 };
+
+#endif // COMMON_TYPES_H
@@ -0,0 +1,64 @@
+#ifndef RT_DEADLINE_H
+#define RT_DEADLINE_H
+
+#include <stdint.h>
+
+// Release/deadline bookkeeping of one rt_task, kept free of FreeRTOS and
+// esp_timer so it also builds on the host (see host/rt_task_check.c).
+//
+// Every release gets a sequence number. The deadline timer is armed for one
+// release at a time, and a job is only counted as an overrun once, whether
+// its deadline timer fires first or the next release finds it unfinished
+// (with the deadline equal to the period, both happen at the same time).
+// The caller serializes all calls (rt_task.c holds the task's portMUX).
+
+typedef struct {
+    uint32_t release_seq;       // Releases so far, the newest job's number
+    uint32_t completed_seq;     // Last job that finished
+    uint32_t deadline_seq;      // Job the deadline timer is armed for
+    uint32_t missed_seq;        // Last job counted as an overrun
+
+    int64_t release_us;         // Nominal release time of release_seq
+    int64_t deadline_us;        // Absolute deadline of deadline_seq
+
+    uint32_t overruns;          // Jobs not finished by their deadline
+    uint32_t skipped;           // Releases that found the previous job unfinished
+} rt_deadline_t;
+
+/**
+ * @brief Record a release at its nominal alarm time
+ *
+ * The deadline timer now belongs to the new job and should be armed at
+ * deadline_us. The previous job, running or never started, has missed its
+ * deadline if it has not finished.
+ *
+ * @return 1 if the previous job's miss is counted here and the miss handler
+ *         must be called, 0 otherwise
+ */
+int rt_deadline_release(rt_deadline_t *d, int64_t release_us, int64_t deadline_us);
+
+/**
+ * @brief Start the newest released job
+ *
+ * @param release_us    Receives the job's nominal release time
+ * @return The job's sequence number, for rt_deadline_finish()
+ */
+uint32_t rt_deadline_start(rt_deadline_t *d, int64_t *release_us);
+
+/**
+ * @brief Finish a job
+ *
+ * @return 1 if the deadline timer is still armed for this job and can be
+ *         stopped, 0 if a later release already owns it
+ */
+int rt_deadline_finish(rt_deadline_t *d, uint32_t seq);
+
+/**
+ * @brief Deadline timer expired
+ *
+ * @return 1 if the job it was armed for is unfinished and not counted yet,
+ *         so the miss handler must be called
+ */
+int rt_deadline_expired(rt_deadline_t *d);
+
+#endif // RT_DEADLINE_H
@@ -0,0 +1,77 @@
+#ifndef RT_TASK_H
+#define RT_TASK_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+
+// Periodic task framework. Each registered task is released by its own
+// periodic esp_timer, so the period does not drift with the job's run time
+// or the tick rate. A one-shot deadline timer is armed at every release for
+// the alarm time plus deadline_ms, and fires the task's deadline-miss callback
+// if the job has not finished by then (this also catches a job that hangs).
+// When the deadline equals the period, the next release reports the miss if
+// it runs before the timer. rt_task_set_period() changes the rate at runtime.
+
+#define RT_TASK_MAX 8
+
+typedef void (*rt_task_fn_t)(void *arg);
+
+typedef struct {
+    const char *name;
+    rt_task_fn_t job;                   // Runs once per release
+    rt_task_fn_t on_deadline_miss;      // Optional, called from the esp_timer task
+    void *arg;                          // Passed to job and on_deadline_miss
+
+    uint32_t period_ms;
+    uint32_t deadline_ms;               // Relative to release, 0 means equal to the period
+    UBaseType_t priority;
+    BaseType_t core;                    // 0, 1 or tskNO_AFFINITY
+    uint32_t stack_size;
+} rt_task_config_t;
+
+typedef struct {
+    uint32_t activations;       // Jobs started
+    uint32_t overruns;          // Jobs not finished by their deadline
+    uint32_t skipped;           // Releases that found the previous job unfinished
+
+    uint32_t exec_last_us;
+    uint32_t exec_max_us;
+    uint64_t exec_total_us;
+
+    uint32_t jitter_last_us;    // Release-to-start latency
+    uint32_t jitter_max_us;
+} rt_task_stats_t;
+
+typedef struct rt_task rt_task_t;
+
+/**
+ * @brief Create the task and start releasing it every period_ms
+ *
+ * @param out   Optional, receives the task handle for rt_task_get_stats()
+ */
+esp_err_t rt_task_create(const rt_task_config_t *config, rt_task_t **out);
+
+/**
+ * @brief Restart the task's releases with a new period and deadline
+ *
+ * The next release is one new period from now; a job already running keeps
+ * its old deadline. Can be called from the task's own job, e.g. when it
+ * switches to a mode with a different frame rate.
+ *
+ * @param deadline_ms   0 means equal to the period
+ */
+esp_err_t rt_task_set_period(rt_task_t *task, uint32_t period_ms, uint32_t deadline_ms);
+
+/**
+ * @brief Copy a consistent snapshot of the task counters
+ */
+esp_err_t rt_task_get_stats(rt_task_t *task, rt_task_stats_t *stats);
+
+/**
+ * @brief Log the counters of every registered task
+ */
+void rt_task_print_stats(void);
+
+#endif // RT_TASK_H
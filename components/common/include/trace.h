@@ -0,0 +1,115 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Timeline tracer. Pipeline stages record begin/end/instant events with a
+// microsecond timestamp into a ring buffer owned by the core they run on.
+// Slots are claimed with an atomic increment, so recording never takes a
+// lock and never blocks; when a ring is full the oldest events are
+// overwritten. trace_dump() pauses recording, writes both rings in the
+// format below and starts a new capture. host/trace2json.c turns a dump into
+// Chrome trace JSON for chrome://tracing or ui.perfetto.dev.
+//
+// FreeRTOS context switches are recorded by trace_task_switched_in() when
+// the build routes traceTASK_SWITCHED_IN to it, see trace_hook.h.
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 1
+#endif
+
+#define TRACE_CORES 2
+#define TRACE_RING_EVENTS 16384         // Per core, power of two (~10 s with Wi-Fi traffic)
+#define TRACE_MAX_TASKS 32              // Task names kept for context switch events
+#define TRACE_TASK_NAME_LEN 16
+
+typedef enum {
+    TRACE_CONTROL,          // Whole control period
+    TRACE_CAPTURE,          // camera_capture()
+    TRACE_VISION,           // Tracker, mask and odometry
+    TRACE_OVERLAY,
+    TRACE_MOTOR_UPDATE,
+    TRACE_STREAM_COPY,      // Frame and mask copies into the web streamer
+    TRACE_JPEG_ENCODE,
+    TRACE_HTTP_SEND,
+    TRACE_FRAME_LOCK_WAIT,  // Spinning on frame_lock
+    TRACE_FRAME_LOCK,       // Holding frame_lock
+    TRACE_TASK_SWITCH,      // Instant, arg is the task switched in
+    TRACE_EVENT_MAX
+} trace_event_t;
+
+typedef enum {
+    TRACE_BEGIN,
+    TRACE_END,
+    TRACE_INSTANT
+} trace_phase_t;
+
+// --- Dump format, all fields little-endian ---
+//
+//   trace_dump_header_t
+//   event_count x char[TRACE_TASK_NAME_LEN]      Event names, by trace_event_t
+//   task_count x char[TRACE_TASK_NAME_LEN]       Task names, by index
+//   For each core: uint32_t count, count x trace_record_t, oldest first
+
+#define TRACE_DUMP_MAGIC 0x52544352     // "RCTR"
+#define TRACE_DUMP_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t cores;
+    uint16_t event_count;
+    uint16_t task_count;
+    uint32_t dropped[TRACE_CORES];      // Events overwritten before this dump
+} trace_dump_header_t;
+
+typedef struct {
+    uint32_t time_us;       // Low 32 bits of esp_timer_get_time()
+    uint32_t arg;           // Task index for begin/end and task switches, else the caller's value
+    uint8_t phase;          // trace_phase_t
+    uint8_t event;          // trace_event_t
+    uint16_t reserved;
+} trace_record_t;
+
+typedef esp_err_t (*trace_write_fn_t)(void *ctx, const void *data, size_t len);
+
+/**
+ * @brief Context switch hook, called by FreeRTOS after selecting the next task
+ */
+void trace_task_switched_in(void);
+
+#if TRACE_ENABLE
+
+/**
+ * @brief Allocate the rings (PSRAM when available) and start recording
+ */
+esp_err_t trace_init(void);
+
+void trace_begin(trace_event_t event);
+void trace_end(trace_event_t event);
+void trace_instant(trace_event_t event, uint32_t arg);
+
+/**
+ * @brief Write everything recorded since the last dump, then start over
+ *
+ * Recording is paused while the data is written, so a slow writer only
+ * costs the events that happen during the dump.
+ *
+ * @return ESP_ERR_TIMEOUT, without writing anything, if a claimed slot was
+ *         not filled within a few ticks
+ */
+esp_err_t trace_dump(trace_write_fn_t write, void *ctx);
+
+#else
+
+static inline esp_err_t trace_init(void) { return ESP_OK; }
+static inline void trace_begin(trace_event_t event) { (void)event; }
+static inline void trace_end(trace_event_t event) { (void)event; }
+static inline void trace_instant(trace_event_t event, uint32_t arg) { (void)event; (void)arg; }
+static inline esp_err_t trace_dump(trace_write_fn_t write, void *ctx) { (void)write; (void)ctx; return ESP_ERR_NOT_SUPPORTED; }
+
+#endif // TRACE_ENABLE
+
+#endif // TRACE_H
@@ -0,0 +1,13 @@
+#ifndef TRACE_HOOK_H
+#define TRACE_HOOK_H
+
+// Force-included into every C file when ROBOCAR_TRACE_CONTEXT_SWITCHES is
+// on (see the top-level CMakeLists.txt), so FreeRTOS's tasks.c sees the hook
+// before it falls back to the empty default. ESP-IDF has no user hook for
+// this: it only defines traceTASK_SWITCHED_IN itself for SystemView
+// (CONFIG_APPTRACE_SV_ENABLE), which must stay off.
+
+void trace_task_switched_in(void);
+#define traceTASK_SWITCHED_IN() trace_task_switched_in()
+
+#endif // TRACE_HOOK_H
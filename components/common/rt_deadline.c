@@ -0,0 +1,56 @@
+#include "rt_deadline.h"
+
+/**
+ * Private function declarations
+ */
+static int count_miss(rt_deadline_t *d, uint32_t seq);
+
+/**
+ * Public function definitions
+ */
+int rt_deadline_release(rt_deadline_t *d, int64_t release_us, int64_t deadline_us) {
+    int miss = 0;
+
+    // The deadline is never later than the next release, so a job that has
+    // not finished by now is late even if its deadline timer has not fired
+    if(d->deadline_seq != 0 && d->completed_seq != d->deadline_seq) {
+        d->skipped++;
+        miss = count_miss(d, d->deadline_seq);
+    }
+
+    d->release_seq++;
+    d->release_us = release_us;
+    d->deadline_seq = d->release_seq;
+    d->deadline_us = deadline_us;
+    return miss;
+}
+
+uint32_t rt_deadline_start(rt_deadline_t *d, int64_t *release_us) {
+    *release_us = d->release_us;
+    return d->release_seq;
+}
+
+int rt_deadline_finish(rt_deadline_t *d, uint32_t seq) {
+    d->completed_seq = seq;
+    return d->deadline_seq == seq;
+}
+
+int rt_deadline_expired(rt_deadline_t *d) {
+    // Also a miss when the job was released but never got to start
+    if(d->deadline_seq == 0 || d->completed_seq == d->deadline_seq) {
+        return 0;
+    }
+    return count_miss(d, d->deadline_seq);
+}
+
+/**
+ * Private functions
+ */
+static int count_miss(rt_deadline_t *d, uint32_t seq) {
+    if(d->missed_seq == seq) {
+        return 0;
+    }
+    d->missed_seq = seq;
+    d->overruns++;
+    return 1;
+}
@@ -0,0 +1,248 @@
+#include <string.h>
+#include "rt_task.h"
+#include "rt_deadline.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "RT_TASK";
+
+struct rt_task {
+    rt_task_config_t config;
+    TaskHandle_t handle;
+    esp_timer_handle_t release_timer;
+    esp_timer_handle_t deadline_timer;
+
+    int64_t next_release_us;        // Nominal time of the next periodic alarm, guarded by lock
+    rt_deadline_t deadline;         // Guarded by lock
+
+    rt_task_stats_t stats;
+    portMUX_TYPE lock;
+};
+
+static rt_task_t tasks[RT_TASK_MAX];
+static int task_count = 0;
+static portMUX_TYPE registry_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * Private function declarations
+ */
+static void release_cb(void *arg);
+static void deadline_cb(void *arg);
+static void task_loop(void *arg);
+static void arm_deadline(rt_task_t *task, int64_t deadline_us);
+
+/**
+ * Public function definitions
+ */
+esp_err_t rt_task_create(const rt_task_config_t *config, rt_task_t **out) {
+    if(config == NULL || config->job == NULL || config->period_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&registry_lock);
+    if(task_count >= RT_TASK_MAX) {
+        portEXIT_CRITICAL(&registry_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    rt_task_t *task = &tasks[task_count++];
+    portEXIT_CRITICAL(&registry_lock);
+
+    memset(task, 0, sizeof(*task));
+    task->config = *config;
+    if(task->config.deadline_ms == 0 || task->config.deadline_ms > task->config.period_ms) {
+        task->config.deadline_ms = task->config.period_ms;
+    }
+    task->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+    // Rate-monotonic order: a shorter period should never run at a lower priority
+    for(rt_task_t *other = tasks; other < task; other++) {
+        if((other->config.period_ms < config->period_ms && other->config.priority < config->priority) ||
+           (other->config.period_ms > config->period_ms && other->config.priority > config->priority)) {
+            ESP_LOGW(TAG, "%s and %s break rate-monotonic priority order",
+                     config->name, other->config.name);
+        }
+    }
+
+    const esp_timer_create_args_t release_args = {
+        .callback = release_cb,
+        .arg = task,
+        .name = "rt_release"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&release_args, &task->release_timer));
+
+    const esp_timer_create_args_t deadline_args = {
+        .callback = deadline_cb,
+        .arg = task,
+        .name = "rt_deadline"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&deadline_args, &task->deadline_timer));
+
+    BaseType_t ok = xTaskCreatePinnedToCore(task_loop, config->name, config->stack_size, task,
+                                            config->priority, &task->handle, config->core);
+    if(ok != pdPASS) {
+        ESP_LOGE(TAG, "Could not create task %s", config->name);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Periodic alarms are spaced exactly one period apart from the start, so
+    // release and deadline times are derived from here instead of from when
+    // the callbacks happen to run
+    portENTER_CRITICAL(&task->lock);
+    task->next_release_us = esp_timer_get_time() + (int64_t)config->period_ms * 1000;
+    portEXIT_CRITICAL(&task->lock);
+    ESP_ERROR_CHECK(esp_timer_start_periodic(task->release_timer, (uint64_t)config->period_ms * 1000));
+    ESP_LOGI(TAG, "%s: period %lu ms, deadline %lu ms, prio %u, core %d", config->name,
+             config->period_ms, task->config.deadline_ms, config->priority, config->core);
+
+    if(out) *out = task;
+    return ESP_OK;
+}
+
+esp_err_t rt_task_set_period(rt_task_t *task, uint32_t period_ms, uint32_t deadline_ms) {
+    if(task == NULL || period_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(deadline_ms == 0 || deadline_ms > period_ms) {
+        deadline_ms = period_ms;
+    }
+
+    esp_timer_stop(task->release_timer);
+    portENTER_CRITICAL(&task->lock);
+    task->config.period_ms = period_ms;
+    task->config.deadline_ms = deadline_ms;
+    task->next_release_us = esp_timer_get_time() + (int64_t)period_ms * 1000;
+    portEXIT_CRITICAL(&task->lock);
+
+    esp_err_t err = esp_timer_start_periodic(task->release_timer, (uint64_t)period_ms * 1000);
+    if(err == ESP_OK) {
+        ESP_LOGI(TAG, "%s: period %lu ms, deadline %lu ms", task->config.name, period_ms, deadline_ms);
+    }
+    return err;
+}
+
+esp_err_t rt_task_get_stats(rt_task_t *task, rt_task_stats_t *stats) {
+    if(task == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&task->lock);
+    *stats = task->stats;
+    stats->overruns = task->deadline.overruns;
+    stats->skipped = task->deadline.skipped;
+    portEXIT_CRITICAL(&task->lock);
+    return ESP_OK;
+}
+
+void rt_task_print_stats(void) {
+    float utilization = 0;
+
+    for(int i = 0; i < task_count; i++) {
+        rt_task_stats_t s;
+        rt_task_get_stats(&tasks[i], &s);
+
+        uint32_t avg_us = s.activations ? (uint32_t)(s.exec_total_us / s.activations) : 0;
+        utilization += (float)avg_us / (tasks[i].config.period_ms * 1000.0f);
+
+        ESP_LOGI(TAG, "%-10s runs %lu  exec avg/max %lu/%lu us  jitter max %lu us  overruns %lu  skipped %lu",
+                 tasks[i].config.name, s.activations, avg_us, s.exec_max_us,
+                 s.jitter_max_us, s.overruns, s.skipped);
+    }
+    ESP_LOGI(TAG, "Total utilization: %.1f%%", utilization * 100.0f);
+}
+
+/**
+ * Private functions
+ */
+
+// Runs in the esp_timer task at every period boundary
+static void release_cb(void *arg) {
+    rt_task_t *task = (rt_task_t *)arg;
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&task->lock);
+    int64_t period_us = (int64_t)task->config.period_ms * 1000;
+    int64_t release_us = task->next_release_us;
+    // Alarms never fire early, so one this far ahead of the schedule was
+    // already running when rt_task_set_period() restarted the timer
+    if(now_us < release_us - period_us / 2) {
+        portEXIT_CRITICAL(&task->lock);
+        return;
+    }
+    int64_t deadline_us = release_us + (int64_t)task->config.deadline_ms * 1000;
+    task->next_release_us += period_us;
+    int missed = rt_deadline_release(&task->deadline, release_us, deadline_us);
+    portEXIT_CRITICAL(&task->lock);
+
+    // With the deadline equal to the period this release may run before the
+    // previous job's deadline timer, so it reports the miss itself
+    if(missed && task->config.on_deadline_miss) {
+        task->config.on_deadline_miss(task->config.arg);
+    }
+
+    arm_deadline(task, deadline_us);
+    xTaskNotifyGive(task->handle);
+}
+
+// Runs in the esp_timer task when a job has not completed by its deadline
+static void deadline_cb(void *arg) {
+    rt_task_t *task = (rt_task_t *)arg;
+
+    portENTER_CRITICAL(&task->lock);
+    int missed = rt_deadline_expired(&task->deadline);
+    portEXIT_CRITICAL(&task->lock);
+
+    if(missed && task->config.on_deadline_miss) {
+        task->config.on_deadline_miss(task->config.arg);
+    }
+}
+
+static void task_loop(void *arg) {
+    rt_task_t *task = (rt_task_t *)arg;
+
+    while(1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        int64_t start_us = esp_timer_get_time();
+        int64_t release_us;
+        portENTER_CRITICAL(&task->lock);
+        uint32_t seq = rt_deadline_start(&task->deadline, &release_us);
+        portEXIT_CRITICAL(&task->lock);
+
+        task->config.job(task->config.arg);
+
+        int64_t end_us = esp_timer_get_time();
+        portENTER_CRITICAL(&task->lock);
+        int owns_timer = rt_deadline_finish(&task->deadline, seq);
+        portEXIT_CRITICAL(&task->lock);
+
+        // Stopping is only an optimization, deadline_cb ignores finished
+        // jobs. A release may re-arm the timer for the next job between the
+        // check and the stop, in which case it is armed again.
+        if(owns_timer) {
+            esp_timer_stop(task->deadline_timer);
+            portENTER_CRITICAL(&task->lock);
+            int64_t rearm_us = task->deadline.deadline_seq != seq ? task->deadline.deadline_us : 0;
+            portEXIT_CRITICAL(&task->lock);
+            if(rearm_us) arm_deadline(task, rearm_us);
+        }
+
+        uint32_t exec_us = (uint32_t)(end_us - start_us);
+        uint32_t jitter_us = start_us > release_us ? (uint32_t)(start_us - release_us) : 0;
+
+        portENTER_CRITICAL(&task->lock);
+        task->stats.activations++;
+        task->stats.exec_last_us = exec_us;
+        task->stats.exec_total_us += exec_us;
+        if(exec_us > task->stats.exec_max_us) task->stats.exec_max_us = exec_us;
+        task->stats.jitter_last_us = jitter_us;
+        if(jitter_us > task->stats.jitter_max_us) task->stats.jitter_max_us = jitter_us;
+        portEXIT_CRITICAL(&task->lock);
+    }
+}
+
+// One-shot timers only take a relative timeout; a deadline already in the
+// past fires at once
+static void arm_deadline(rt_task_t *task, int64_t deadline_us) {
+    int64_t timeout_us = deadline_us - esp_timer_get_time();
+    esp_timer_stop(task->deadline_timer);
+    esp_timer_start_once(task->deadline_timer, timeout_us > 0 ? timeout_us : 1);
+}
@@ -0,0 +1,223 @@
+#include <stdbool.h>
+#include <string.h>
+#include "trace.h"
+
+#if TRACE_ENABLE
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "trace";
+
+#define SETTLE_TICKS 10     // Longest a dump waits for writers to fill claimed slots
+
+static const char *EVENT_NAMES[TRACE_EVENT_MAX] = {
+    [TRACE_CONTROL]         = "control",
+    [TRACE_CAPTURE]         = "capture",
+    [TRACE_VISION]          = "vision",
+    [TRACE_OVERLAY]         = "overlay",
+    [TRACE_MOTOR_UPDATE]    = "motor_update",
+    [TRACE_STREAM_COPY]     = "stream_copy",
+    [TRACE_JPEG_ENCODE]     = "jpeg_encode",
+    [TRACE_HTTP_SEND]       = "http_send",
+    [TRACE_FRAME_LOCK_WAIT] = "frame_lock_wait",
+    [TRACE_FRAME_LOCK]      = "frame_lock",
+    [TRACE_TASK_SWITCH]     = "task_switch",
+};
+
+typedef struct {
+    trace_record_t *records;
+    uint32_t head;          // Slots claimed since the last dump
+    uint32_t committed;     // Claimed slots that have been filled
+} trace_ring_t;
+
+static trace_ring_t rings[TRACE_CORES];
+static volatile bool recording = false;
+
+// Filled in the first time a task records an event or is switched in. A slot
+// is claimed by swapping its handle in, then the name is written and
+// task_count raised past it, so entries below task_count are complete.
+// Entries are never removed, so lookups need no lock.
+static void *task_handles[TRACE_MAX_TASKS];
+static char task_names[TRACE_MAX_TASKS][TRACE_TASK_NAME_LEN];
+static uint32_t task_count = 0;
+
+/**
+ * Private function declarations
+ */
+static void record(trace_phase_t phase, trace_event_t event, uint32_t arg);
+static uint32_t task_index(void *handle);
+static bool ring_settle(trace_ring_t *ring, uint32_t *claimed);
+
+/**
+ * Public function definitions
+ */
+esp_err_t trace_init(void) {
+    for(int core = 0; core < TRACE_CORES; core++) {
+        if(rings[core].records != NULL) continue;
+        // Too large for internal RAM; the hooks never run with the cache
+        // disabled, since the scheduler is suspended during flash operations
+        rings[core].records = heap_caps_calloc(TRACE_RING_EVENTS, sizeof(trace_record_t), MALLOC_CAP_SPIRAM);
+        if(rings[core].records == NULL) {
+            ESP_LOGE(TAG, "No PSRAM for the core %d ring", core);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    recording = true;
+    ESP_LOGI(TAG, "Recording %d events per core", TRACE_RING_EVENTS);
+    return ESP_OK;
+}
+
+// Begin/end carry the task so the host tool can nest them per task
+void trace_begin(trace_event_t event) {
+    if(!recording) return;
+    record(TRACE_BEGIN, event, task_index(xTaskGetCurrentTaskHandle()));
+}
+
+void trace_end(trace_event_t event) {
+    if(!recording) return;
+    record(TRACE_END, event, task_index(xTaskGetCurrentTaskHandle()));
+}
+
+void trace_instant(trace_event_t event, uint32_t arg) {
+    record(TRACE_INSTANT, event, arg);
+}
+
+void IRAM_ATTR trace_task_switched_in(void) {
+    if(!recording) return;
+    record(TRACE_INSTANT, TRACE_TASK_SWITCH, task_index(xTaskGetCurrentTaskHandle()));
+}
+
+esp_err_t trace_dump(trace_write_fn_t write, void *ctx) {
+    if(rings[0].records == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Let writers that claimed a slot before the pause finish filling it
+    recording = false;
+    uint32_t heads[TRACE_CORES];
+    for(int core = 0; core < TRACE_CORES; core++) {
+        if(!ring_settle(&rings[core], &heads[core])) {
+            recording = true;
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    uint32_t tasks = __atomic_load_n(&task_count, __ATOMIC_ACQUIRE);
+    trace_dump_header_t header = {
+        .magic = TRACE_DUMP_MAGIC,
+        .version = TRACE_DUMP_VERSION,
+        .cores = TRACE_CORES,
+        .event_count = TRACE_EVENT_MAX,
+        .task_count = tasks,
+    };
+    for(int core = 0; core < TRACE_CORES; core++) {
+        header.dropped[core] = heads[core] > TRACE_RING_EVENTS ? heads[core] - TRACE_RING_EVENTS : 0;
+    }
+
+    esp_err_t err = write(ctx, &header, sizeof(header));
+    for(int i = 0; i < TRACE_EVENT_MAX && err == ESP_OK; i++) {
+        char name[TRACE_TASK_NAME_LEN] = { 0 };
+        strncpy(name, EVENT_NAMES[i], sizeof(name) - 1);
+        err = write(ctx, name, sizeof(name));
+    }
+    for(uint32_t i = 0; i < tasks && err == ESP_OK; i++) {
+        err = write(ctx, task_names[i], TRACE_TASK_NAME_LEN);
+    }
+
+    for(int core = 0; core < TRACE_CORES && err == ESP_OK; core++) {
+        uint32_t count = heads[core] - header.dropped[core];
+        uint32_t start = header.dropped[core] & (TRACE_RING_EVENTS - 1);
+        uint32_t first = count < TRACE_RING_EVENTS - start ? count : TRACE_RING_EVENTS - start;
+
+        err = write(ctx, &count, sizeof(count));
+        if(err == ESP_OK && first > 0) {
+            err = write(ctx, &rings[core].records[start], first * sizeof(trace_record_t));
+        }
+        if(err == ESP_OK && count > first) {
+            err = write(ctx, rings[core].records, (count - first) * sizeof(trace_record_t));
+        }
+    }
+
+    // Start over only from a settled ring, and only if nobody claimed a slot
+    // in between; otherwise the next dump repeats these events instead of
+    // counting commits that belong to a slot it no longer covers
+    for(int core = 0; core < TRACE_CORES; core++) {
+        trace_ring_t *ring = &rings[core];
+        uint32_t claimed;
+        if(ring_settle(ring, &claimed) &&
+           __atomic_compare_exchange_n(&ring->head, &claimed, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            __atomic_fetch_sub(&ring->committed, claimed, __ATOMIC_RELEASE);
+        }
+    }
+    recording = true;
+    return err;
+}
+
+/**
+ * Private functions
+ */
+static inline void IRAM_ATTR record(trace_phase_t phase, trace_event_t event, uint32_t arg) {
+    if(!recording) return;
+
+    // Only this core's writers (tasks, ISRs, the switch hook) normally touch
+    // the ring, but a task may migrate between claiming and filling a slot
+    trace_ring_t *ring = &rings[xPortGetCoreID()];
+    uint32_t slot = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    trace_record_t *r = &ring->records[slot & (TRACE_RING_EVENTS - 1)];
+
+    r->time_us = (uint32_t)esp_timer_get_time();
+    r->arg = arg;
+    r->phase = phase;
+    r->event = event;
+    r->reserved = 0;
+    __atomic_fetch_add(&ring->committed, 1, __ATOMIC_RELEASE);
+}
+
+static uint32_t IRAM_ATTR task_index(void *handle) {
+    uint32_t count = __atomic_load_n(&task_count, __ATOMIC_ACQUIRE);
+    for(uint32_t i = 0; i < count; i++) {
+        if(__atomic_load_n(&task_handles[i], __ATOMIC_RELAXED) == handle) return i;
+    }
+
+    // Claimed but unpublished slots are checked too: the switch hook may
+    // register a task that was preempted while registering itself
+    for(uint32_t i = count; i < TRACE_MAX_TASKS; i++) {
+        void *expected = NULL;
+        if(!__atomic_compare_exchange_n(&task_handles[i], &expected, handle, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            if(expected == handle) return i;
+            continue;
+        }
+
+        strncpy(task_names[i], pcTaskGetName(handle), TRACE_TASK_NAME_LEN - 1);
+        uint32_t published = __atomic_load_n(&task_count, __ATOMIC_RELAXED);
+        while(published <= i &&
+              !__atomic_compare_exchange_n(&task_count, &published, i + 1, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+        return i;
+    }
+    return TRACE_MAX_TASKS;     // Shown as an unnamed task
+}
+
+// Waits for every claimed slot to be filled. A writer preempted between
+// claiming and filling may hold this up, so the wait is bounded.
+static bool ring_settle(trace_ring_t *ring, uint32_t *claimed) {
+    for(int tick = 0; ; tick++) {
+        *claimed = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&ring->committed, __ATOMIC_ACQUIRE) == *claimed) return true;
+        if(tick == SETTLE_TICKS) return false;
+        vTaskDelay(1);
+    }
+}
+
+#else
+
+void trace_task_switched_in(void) {
+}
+
+#endif // TRACE_ENABLE
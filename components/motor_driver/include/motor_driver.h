@@ -6,6 +6,7 @@
 #include "driver/gpio.h"
 #include "driver/ledc.h"
 #include "esp_err.h"
+#include "motor_duty.h"
 
 #define GPIO_LA     GPIO_NUM_18
 #define GPIO_LB     GPIO_NUM_19
@@ -50,6 +51,5 @@ esp_err_t motor_set_duty(motor_config_t *config, uint32_t duty);
 esp_err_t motor_set_dir(motor_config_t *config, motor_dir_t dir);
 esp_err_t motor_stop(motor_config_t *config);
 esp_err_t car_stop();
-uint32_t percent_to_duty(float percent);
 
 #endif // MOTOR_DRIVER_H
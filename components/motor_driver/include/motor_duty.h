@@ -0,0 +1,17 @@
+#ifndef MOTOR_DUTY_H
+#define MOTOR_DUTY_H
+
+#include <stdint.h>
+
+// Speed command to PWM duty mapping. Kept apart from the LEDC driver so the
+// host simulator integrates the same duties the firmware writes.
+
+#define MOTOR_DUTY_BITS 13      // LEDC_DUTY_RES
+#define MOTOR_DUTY_MAX  ((1 << MOTOR_DUTY_BITS) - 1)
+
+/**
+ * @brief Convert a 0-100 % speed command to a duty, clamping out-of-range input
+ */
+uint32_t percent_to_duty(float percent);
+
+#endif // MOTOR_DUTY_H
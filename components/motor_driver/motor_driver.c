@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include "motor_driver.h"
 
+_Static_assert(LEDC_DUTY_RES == MOTOR_DUTY_BITS, "motor_duty.h must match the LEDC timer resolution");
+
 motor_config_t motor_left = {
     .side = LEFT,
     .duty = 0,
@@ -77,12 +79,6 @@ esp_err_t car_stop() {
     return ESP_OK;
 }  
 
-uint32_t percent_to_duty(float percent) {
-    if (percent < 0.0f) percent = 0.0f;
-    if (percent > 100.0f) percent = 100.0f;
-    return (uint32_t)((percent / 100.0f) * ((1 << LEDC_DUTY_RES) - 1));
-}
-
 // esp_err_t motor_ramp_duty(motor_config_t *config, uint32_t start_duty, uint32_t target_duty, uint32_t time_ms) {
 //     if (config == NULL) {
 //         return ESP_ERR_INVALID_ARG;
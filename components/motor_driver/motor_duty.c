@@ -0,0 +1,7 @@
+#include "motor_duty.h"
+
+uint32_t percent_to_duty(float percent) {
+    if (percent < 0.0f) percent = 0.0f;
+    if (percent > 100.0f) percent = 100.0f;
+    return (uint32_t)((percent / 100.0f) * MOTOR_DUTY_MAX);
+}
@@ -1 +1,70 @@
-void func(void);
+#ifndef NAVIGATOR_H
+#define NAVIGATOR_H
+
+#include <stdint.h>
+#include "common_types.h"
+#include "ttc_estimator.h"
+
+// Steering logic for blob following. Kept free of ESP-IDF dependencies so
+// the host simulator (host/robocar_sim.c) runs exactly this code.
+//
+// The turn effort is kp times the centroid's offset from center_x. In line
+// mode it also has a kd_heading term for the tape's direction, which starts
+// the turn before the look-ahead point has drifted off center.
+//
+// With a standoff set, the forward speed is also limited on the approach:
+// the time left until the standoff is the time to contact scaled by the
+// share of the distance still to cover (1 - width / standoff_width, since
+// the image width grows as 1 / distance). Width here is the blob's mean row
+// width, area / bounding box height. Below ttc_slow_s the speed is
+// reduced in proportion, which brakes harder the faster the car closes in.
+
+#define NAV_LOST_FRAMES 10          // Missed frames tolerated before stopping
+#define NAV_MIN_APPROACH_SPEED 12   // Percent, keeps the wheels above the motor deadband while braking
+#define NAV_RESUME_RATIO 0.85f      // After arriving, drive again once the target shrinks below this share
+
+typedef struct {
+    float base_speed;   // Percent duty when driving straight
+    float kp;           // Turn effort per pixel of error
+    float kd_heading;   // Turn effort per radian of nav_frame_t heading_rad
+    int center_x;       // Steering set point in QVGA pixels
+    int standoff_width; // Target width in QVGA pixels at which to stop, 0 to drive until lost
+    float ttc_slow_s;   // Start braking this many seconds before the standoff, 0 to disable
+} nav_gains_t;
+
+typedef enum {
+    NAV_DRIVE,          // Apply left/right
+    NAV_HOLD,           // Target missing, keep the last command
+    NAV_STOP,           // Target lost for too long, stop the car
+    NAV_ARRIVED         // Target reached the standoff width, stop and hold
+} nav_action_t;
+
+typedef struct {
+    int width;          // Size of the frame the blob was found in
+    int height;
+    int64_t time_us;    // Capture time
+    float heading_rad;  // Line mode: fitted tape direction, positive to the right; 0 for blobs
+} nav_frame_t;
+
+typedef struct {
+    float left;         // Percent duty, 0-100
+    float right;
+} nav_command_t;
+
+typedef struct {
+    uint8_t lost_frames;
+    uint8_t arrived;
+    ttc_estimator_t ttc;
+} navigator_t;
+
+/**
+ * @brief Turn one tracker result into a wheel command
+ *
+ * @param blob    Detected target, or NULL when nothing was found this frame
+ * @param frame   Frame the blob was found in; coordinates are scaled to
+ *                REF_FRAME_WIDTH before steering
+ */
+nav_action_t navigator_update(navigator_t *nav, const color_blob_t *blob, const nav_frame_t *frame,
+                              const nav_gains_t *gains, nav_command_t *cmd);
+
+#endif // NAVIGATOR_H
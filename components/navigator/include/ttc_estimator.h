@@ -0,0 +1,56 @@
+#ifndef TTC_ESTIMATOR_H
+#define TTC_ESTIMATOR_H
+
+#include <stdint.h>
+#include "common_types.h"
+
+// Time to contact from the growth of the target's image. The apparent size
+// of an object is inversely proportional to its distance, so at a constant
+// closing speed the time to contact is size / (d size / dt), without knowing
+// either the distance or the speed.
+//
+// Each frame compares width, height and sqrt(area) with the previous frame
+// and keeps the median of the three ratios, skipping dimensions clipped by
+// the frame edge. Ratios beyond TTC_MAX_RATIO are rejected as tracker
+// glitches. The resulting expansion rates go through a 3-sample median and
+// an exponential average. All of it is a few float operations per frame.
+
+#define TTC_MAX_RATIO       1.25f       // Largest believable size change between two frames
+#define TTC_MAX_GAP_US      500000      // Older reference frames are dropped instead of compared
+#define TTC_ALPHA           0.35f       // Weight of the newest rate in the average
+#define TTC_MIN_RATE        0.02f       // Expansion per second below which contact is "never"
+
+typedef struct {
+    float width;            // Previous frame's measurements, QVGA-scaled pixels
+    float height;
+    float root_area;
+    uint8_t clip;           // Edges touched by the previous bounding box
+    int64_t time_us;
+    uint8_t has_reference;  // The fields above hold a previous frame
+
+    float rates[3];         // Recent accepted expansion rates, 1/s
+    uint8_t rate_count;
+    float rate;             // Filtered expansion rate, 1/s (positive when approaching)
+    uint8_t valid;          // rate holds at least one accepted sample
+} ttc_estimator_t;
+
+void ttc_reset(ttc_estimator_t *ttc);
+
+/**
+ * @brief Add one detection and update the estimate
+ *
+ * @param blob          Target found in this frame
+ * @param frame_width   Frame size the blob coordinates refer to
+ * @param time_us       Capture time of the frame
+ *
+ * @return 1 if this frame produced an accepted sample, 0 if it only set the
+ *         reference (first frame, long gap) or was rejected as an outlier
+ */
+int ttc_update(ttc_estimator_t *ttc, const color_blob_t *blob, int frame_width, int frame_height, int64_t time_us);
+
+/**
+ * @brief Current time to contact in seconds, INFINITY when not closing in
+ */
+float ttc_seconds(const ttc_estimator_t *ttc);
+
+#endif // TTC_ESTIMATOR_H
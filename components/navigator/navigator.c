@@ -1,7 +1,72 @@
-#include <stdio.h>
+#include <stddef.h>
 #include "navigator.h"
 
-void func(void)
-{
+/**
+ * Private function declarations
+ */
+static float clamp_percent(float percent);
+static float approach_speed(const navigator_t *nav, float width, const nav_gains_t *gains);
 
+/**
+ * Public function definitions
+ */
+nav_action_t navigator_update(navigator_t *nav, const color_blob_t *blob, const nav_frame_t *frame,
+                              const nav_gains_t *gains, nav_command_t *cmd) {
+    if(blob == NULL) {
+        if(nav->lost_frames++ > NAV_LOST_FRAMES) {
+            // The next target starts a new approach, not a stale closing rate
+            nav->lost_frames = 0;
+            ttc_reset(&nav->ttc);
+            return NAV_STOP;
+        }
+        return NAV_HOLD;
+    }
+
+    ttc_update(&nav->ttc, blob, frame->width, frame->height, frame->time_us);
+
+    float speed = gains->base_speed;
+    if(gains->standoff_width > 0) {
+        // Mean row width rather than the bounding box, which a few stray
+        // pixels next to the target can stretch
+        float rows = blob->bottom_right.y - blob->top_left.y + 1;
+        float width = blob->area / rows * REF_FRAME_WIDTH / frame->width;
+        float stop_width = nav->arrived ? NAV_RESUME_RATIO * gains->standoff_width : gains->standoff_width;
+
+        nav->arrived = width >= stop_width;
+        if(nav->arrived) {
+            cmd->left = 0;
+            cmd->right = 0;
+            return NAV_ARRIVED;
+        }
+        speed = approach_speed(nav, width, gains);
+    }
+
+    int error = blob->centroid.x * REF_FRAME_WIDTH / frame->width - gains->center_x;
+    float turn_effort = error * gains->kp + frame->heading_rad * gains->kd_heading;
+
+    cmd->left = clamp_percent(speed + turn_effort);
+    cmd->right = clamp_percent(speed - turn_effort);
+    return NAV_DRIVE;
+}
+
+/**
+ * Private functions
+ */
+static float clamp_percent(float percent) {
+    if(percent > 100) { return 100; }
+    if(percent < 0) { return 0; }
+    return percent;
+}
+
+static float approach_speed(const navigator_t *nav, float width, const nav_gains_t *gains) {
+    float to_standoff = ttc_seconds(&nav->ttc) * (1 - width / gains->standoff_width);
+    if(gains->ttc_slow_s <= 0 || to_standoff >= gains->ttc_slow_s) {
+        return gains->base_speed;
+    }
+
+    float speed = gains->base_speed * to_standoff / gains->ttc_slow_s;
+    if(speed < NAV_MIN_APPROACH_SPEED) {
+        speed = gains->base_speed < NAV_MIN_APPROACH_SPEED ? gains->base_speed : NAV_MIN_APPROACH_SPEED;
+    }
+    return speed;
 }
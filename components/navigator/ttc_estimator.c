@@ -0,0 +1,96 @@
+#include <math.h>
+#include <string.h>
+#include "ttc_estimator.h"
+
+#define CLIP_X 1
+#define CLIP_Y 2
+
+/**
+ * Private function declarations
+ */
+static float median3(float a, float b, float c);
+static uint8_t clipped_edges(const color_blob_t *blob, int frame_width, int frame_height);
+
+/**
+ * Public function definitions
+ */
+void ttc_reset(ttc_estimator_t *ttc) {
+    memset(ttc, 0, sizeof(*ttc));
+}
+
+int ttc_update(ttc_estimator_t *ttc, const color_blob_t *blob, int frame_width, int frame_height, int64_t time_us) {
+    float scale = (float)REF_FRAME_WIDTH / frame_width;     // Sizes are kept in QVGA pixels
+    float width = (blob->bottom_right.x - blob->top_left.x + 1) * scale;
+    float height = (blob->bottom_right.y - blob->top_left.y + 1) * scale;
+    float root_area = sqrtf((float)blob->area) * scale;
+    uint8_t clip = clipped_edges(blob, frame_width, frame_height);
+
+    int64_t dt_us = time_us - ttc->time_us;
+    int have_reference = ttc->has_reference && dt_us > 0 && dt_us <= TTC_MAX_GAP_US;
+    int accepted = 0;
+
+    if(have_reference) {
+        // Size ratios of this frame to the previous one; a dimension cut by
+        // the frame edge in either frame says nothing about distance
+        int clip_x = (clip | ttc->clip) & CLIP_X;
+        int clip_y = (clip | ttc->clip) & CLIP_Y;
+        float ratio_w = clip_x ? NAN : width / ttc->width;
+        float ratio_h = clip_y ? NAN : height / ttc->height;
+        float ratio_a = clip_x || clip_y ? NAN : root_area / ttc->root_area;
+
+        float ratio;
+        if(!isnan(ratio_w) && !isnan(ratio_h)) {
+            ratio = median3(ratio_w, ratio_h, ratio_a);
+        } else {
+            ratio = isnan(ratio_w) ? ratio_h : ratio_w;
+        }
+
+        if(!isnan(ratio) && ratio < TTC_MAX_RATIO && ratio > 1 / TTC_MAX_RATIO) {
+            float rate = logf(ratio) * 1e6f / dt_us;
+
+            ttc->rates[2] = ttc->rates[1];
+            ttc->rates[1] = ttc->rates[0];
+            ttc->rates[0] = rate;
+            if(ttc->rate_count < 3) ttc->rate_count++;
+
+            float filtered = ttc->rate_count < 3 ? rate : median3(ttc->rates[0], ttc->rates[1], ttc->rates[2]);
+            ttc->rate = ttc->valid ? ttc->rate + TTC_ALPHA * (filtered - ttc->rate) : filtered;
+            ttc->valid = 1;
+            accepted = 1;
+        }
+    }
+
+    // An outlier still becomes the reference: if the tracker really jumped
+    // (e.g. to a second blob), the next frame compares against the new target
+    ttc->width = width;
+    ttc->height = height;
+    ttc->root_area = root_area;
+    ttc->clip = clip;
+    ttc->time_us = time_us;
+    ttc->has_reference = 1;
+    return accepted;
+}
+
+float ttc_seconds(const ttc_estimator_t *ttc) {
+    if(!ttc->valid || ttc->rate < TTC_MIN_RATE) {
+        return INFINITY;
+    }
+    return 1 / ttc->rate;
+}
+
+/**
+ * Private functions
+ */
+static float median3(float a, float b, float c) {
+    if(isnan(c)) return (a + b) / 2;
+    if(a > b) { float t = a; a = b; b = t; }
+    if(b > c) b = c;
+    return a > b ? a : b;
+}
+
+static uint8_t clipped_edges(const color_blob_t *blob, int frame_width, int frame_height) {
+    uint8_t clip = 0;
+    if(blob->top_left.x <= 0 || blob->bottom_right.x >= frame_width - 1)   clip |= CLIP_X;
+    if(blob->top_left.y <= 0 || blob->bottom_right.y >= frame_height - 1)  clip |= CLIP_Y;
+    return clip;
+}
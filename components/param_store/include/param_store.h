@@ -0,0 +1,92 @@
+#ifndef PARAM_STORE_H
+#define PARAM_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Live-tunable parameters. Values are persisted in NVS, but the hot loop
+// only ever reads an in-RAM snapshot: compare param_store_version() once per
+// frame and call param_store_snapshot() when it changed. Writers (the HTTP
+// handlers) publish a whole new set at once, so a frame never sees half an
+// update.
+
+typedef struct {
+    // Steering
+    float base_speed;       // Percent duty when driving straight
+    float kp;               // Turn effort per pixel of error
+    float kd_heading;       // Line mode: turn effort per radian of tape heading
+    int32_t center_x;       // Steering set point in QVGA pixels
+    int32_t vision_mode;    // 0: follow a color blob, 1: follow floor tape
+
+    // Approach
+    int32_t standoff_width; // Target width in QVGA pixels to stop at, 0 to disable
+    float ttc_slow_s;       // Seconds before the standoff to start braking
+
+    // Color tracker
+    int32_t min_s;
+    int32_t min_v;
+    int32_t min_area;
+
+    // Web streamer
+    int32_t jpeg_quality;
+} robocar_params_t;
+
+// Compiled-in defaults, used until NVS is loaded and by host/robocar_sim.c
+#define ROBOCAR_PARAMS_DEFAULT() { \
+    .base_speed = 28.0f,           \
+    .kp = 0.04f,                   \
+    .kd_heading = 4.0f,            \
+    .center_x = 160,               \
+    .vision_mode = 0,              \
+    .standoff_width = 120,         \
+    .ttc_slow_s = 1.5f,            \
+    .min_s = 100,                  \
+    .min_v = 50,                   \
+    .min_area = 500,               \
+    .jpeg_quality = 80             \
+}
+
+/**
+ * @brief Load stored values from NVS. Call after nvs_flash_init()
+ *
+ * Until this runs, snapshots return the compiled-in defaults.
+ */
+esp_err_t param_store_init(void);
+
+/**
+ * @brief Current version, incremented on every published update
+ */
+uint32_t param_store_version(void);
+
+/**
+ * @brief Copy the current parameter set without taking a lock
+ *
+ * @return The version of the copied set
+ */
+uint32_t param_store_snapshot(robocar_params_t *out);
+
+/**
+ * @brief Parse, range-check, persist and publish one parameter
+ *
+ * @return ESP_ERR_NOT_FOUND for an unknown name, ESP_ERR_INVALID_ARG for a
+ *         value that does not parse, is out of range, or is not a whole
+ *         number for an integer parameter
+ */
+esp_err_t param_store_set(const char *name, const char *value);
+
+// Receives the JSON text piece by piece, e.g. one HTTP chunk per call
+typedef esp_err_t (*param_store_write_fn_t)(void *ctx, const char *text);
+
+/**
+ * @brief Write every parameter with its range as a JSON array
+ *
+ * The array is passed to write one element at a time, so its size does not
+ * depend on a caller's buffer.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if an element does not fit the element
+ *         buffer, or the first error returned by write
+ */
+esp_err_t param_store_to_json(param_store_write_fn_t write, void *ctx);
+
+#endif // PARAM_STORE_H
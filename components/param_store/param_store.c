@@ -0,0 +1,238 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "param_store.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include "esp_log.h"
+
+static const char *TAG = "PARAM_STORE";
+
+#define NVS_NAMESPACE "params"
+#define JSON_ELEMENT_SIZE 128
+
+typedef enum {
+    PARAM_FLOAT,
+    PARAM_INT
+} param_type_t;
+
+typedef struct {
+    const char *name;       // Also the NVS key, at most 15 characters
+    param_type_t type;
+    size_t offset;          // Field in robocar_params_t
+    float min;
+    float max;
+} param_def_t;
+
+#define PARAM(field, type, min, max) \
+    { #field, type, offsetof(robocar_params_t, field), min, max }
+
+static const param_def_t PARAMS[] = {
+    PARAM(base_speed,     PARAM_FLOAT, 0,  100),
+    PARAM(kp,             PARAM_FLOAT, 0,  1),
+    PARAM(kd_heading,     PARAM_FLOAT, 0,  50),
+    PARAM(center_x,       PARAM_INT,   0,  319),
+    PARAM(vision_mode,    PARAM_INT,   0,  1),
+    PARAM(standoff_width, PARAM_INT,   0,  320),
+    PARAM(ttc_slow_s,     PARAM_FLOAT, 0,  10),
+    PARAM(min_s,          PARAM_INT,   0,  255),
+    PARAM(min_v,          PARAM_INT,   0,  255),
+    PARAM(min_area,       PARAM_INT,   0,  76800),
+    PARAM(jpeg_quality,   PARAM_INT,   10, 100),
+};
+#define PARAM_COUNT ((int)(sizeof(PARAMS) / sizeof(PARAMS[0])))
+
+// Published set, starting at the defaults. Guarded by a sequence counter
+// that is odd while a write is in progress: readers retry instead of locking,
+// writers are serialized by write_mutex and publish inside a critical section
+// so a reader on the same core can never spin on a preempted writer.
+static robocar_params_t live = ROBOCAR_PARAMS_DEFAULT();
+static volatile uint32_t seq = 0;
+static portMUX_TYPE publish_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t write_mutex = NULL;
+
+/**
+ * Private function declarations
+ */
+static void publish(const robocar_params_t *next);
+static esp_err_t parse_value(const param_def_t *def, const char *text, float *out);
+static void field_set(robocar_params_t *p, const param_def_t *def, float value);
+static float field_get(const robocar_params_t *p, const param_def_t *def);
+static const param_def_t *find_param(const char *name);
+
+/**
+ * Public function definitions
+ */
+esp_err_t param_store_init(void) {
+    if(write_mutex == NULL) {
+        write_mutex = xSemaphoreCreateMutex();
+        if(write_mutex == NULL) return ESP_ERR_NO_MEM;
+    }
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if(err == ESP_ERR_NVS_NOT_FOUND) {
+        // Nothing stored yet, keep the defaults
+        return ESP_OK;
+    }
+    if(err != ESP_OK) return err;
+
+    robocar_params_t next;
+    param_store_snapshot(&next);
+
+    for(int i = 0; i < PARAM_COUNT; i++) {
+        const param_def_t *def = &PARAMS[i];
+        uint32_t raw;
+        if(nvs_get_u32(nvs, def->name, &raw) != ESP_OK) continue;
+
+        float value;
+        if(def->type == PARAM_FLOAT) {
+            memcpy(&value, &raw, sizeof(value));
+        } else {
+            value = (float)(int32_t)raw;
+        }
+        if(value < def->min || value > def->max) {
+            ESP_LOGW(TAG, "Ignoring stored %s out of range", def->name);
+            continue;
+        }
+        field_set(&next, def, value);
+    }
+    nvs_close(nvs);
+
+    xSemaphoreTake(write_mutex, portMAX_DELAY);
+    publish(&next);
+    xSemaphoreGive(write_mutex);
+    return ESP_OK;
+}
+
+uint32_t param_store_version(void) {
+    return __atomic_load_n(&seq, __ATOMIC_ACQUIRE) >> 1;
+}
+
+uint32_t param_store_snapshot(robocar_params_t *out) {
+    uint32_t before, after;
+    do {
+        before = __atomic_load_n(&seq, __ATOMIC_ACQUIRE);
+        if(before & 1) continue;
+        memcpy(out, (const void *)&live, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&seq, __ATOMIC_RELAXED);
+    } while((before & 1) || before != after);
+    return before >> 1;
+}
+
+esp_err_t param_store_set(const char *name, const char *value) {
+    if(name == NULL || value == NULL) return ESP_ERR_INVALID_ARG;
+    if(write_mutex == NULL) return ESP_ERR_INVALID_STATE;
+
+    const param_def_t *def = find_param(name);
+    if(def == NULL) return ESP_ERR_NOT_FOUND;
+
+    float parsed;
+    if(parse_value(def, value, &parsed) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(write_mutex, portMAX_DELAY);
+
+    robocar_params_t next;
+    param_store_snapshot(&next);
+    field_set(&next, def, parsed);
+    publish(&next);
+
+    // Persist outside the publish critical section, the hot loop already has the value
+    uint32_t raw;
+    if(def->type == PARAM_FLOAT) {
+        memcpy(&raw, &parsed, sizeof(raw));
+    } else {
+        raw = (uint32_t)(int32_t)parsed;
+    }
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if(err == ESP_OK) {
+        err = nvs_set_u32(nvs, def->name, raw);
+        if(err == ESP_OK) err = nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+
+    xSemaphoreGive(write_mutex);
+
+    if(err != ESP_OK) {
+        ESP_LOGW(TAG, "%s applied but not saved (0x%x)", name, err);
+    }
+    ESP_LOGI(TAG, "%s = %s (version %lu)", name, value, param_store_version());
+    return ESP_OK;
+}
+
+esp_err_t param_store_to_json(param_store_write_fn_t write, void *ctx) {
+    robocar_params_t p;
+    param_store_snapshot(&p);
+
+    // A 15 character name and three %g values need under 100 characters
+    char element[JSON_ELEMENT_SIZE];
+    esp_err_t err = write(ctx, "[");
+    for(int i = 0; i < PARAM_COUNT && err == ESP_OK; i++) {
+        const param_def_t *def = &PARAMS[i];
+        int n = snprintf(element, sizeof(element), "%s{\"name\":\"%s\",\"value\":%g,\"min\":%g,\"max\":%g}",
+                         i ? "," : "", def->name, field_get(&p, def), def->min, def->max);
+        if(n < 0 || n >= (int)sizeof(element)) return ESP_ERR_INVALID_SIZE;
+        err = write(ctx, element);
+    }
+    if(err == ESP_OK) err = write(ctx, "]");
+    return err;
+}
+
+/**
+ * Private functions
+ */
+static void publish(const robocar_params_t *next) {
+    portENTER_CRITICAL(&publish_lock);
+    __atomic_add_fetch(&seq, 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((void *)&live, next, sizeof(live));
+    __atomic_add_fetch(&seq, 1, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL(&publish_lock);
+}
+
+// Integer parameters only take integers: "12.7" is rejected, not truncated
+static esp_err_t parse_value(const param_def_t *def, const char *text, float *out) {
+    char *end;
+    if(def->type == PARAM_FLOAT) {
+        *out = strtof(text, &end);
+    } else {
+        errno = 0;
+        long parsed = strtol(text, &end, 10);
+        if(errno == ERANGE) return ESP_ERR_INVALID_ARG;
+        *out = (float)parsed;
+    }
+    if(end == text || *end != '\0' || !(*out >= def->min && *out <= def->max)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+static void field_set(robocar_params_t *p, const param_def_t *def, float value) {
+    void *field = (uint8_t *)p + def->offset;
+    if(def->type == PARAM_FLOAT) {
+        *(float *)field = value;
+    } else {
+        *(int32_t *)field = (int32_t)value;
+    }
+}
+
+static float field_get(const robocar_params_t *p, const param_def_t *def) {
+    const void *field = (const uint8_t *)p + def->offset;
+    if(def->type == PARAM_FLOAT) {
+        return *(const float *)field;
+    }
+    return (float)*(const int32_t *)field;
+}
+
+static const param_def_t *find_param(const char *name) {
+    for(int i = 0; i < PARAM_COUNT; i++) {
+        if(strcmp(PARAMS[i].name, name) == 0) return &PARAMS[i];
+    }
+    return NULL;
+}
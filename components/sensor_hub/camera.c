@@ -3,6 +3,18 @@
 
 static const char *TAG = "camera";
 
+// Size of the frame handed out by camera_capture_decimated(), put back by
+// camera_release() since the driver reuses the camera_fb_t (COUNT frames,
+// the control task holds at most one at a time)
+static int captured_width;
+static int captured_height;
+static size_t captured_len;
+
+/**
+ * Private function declarations
+ */
+static void decimate(camera_fb_t *fb, int factor);
+
 void register_camera(int clk_freq, const pixformat_t pixel_fromat, const framesize_t frame_size, int quality, const uint8_t fb_count){
     camera_config_t camera_config = {
         .pin_pwdn       = PIN_PWDN,
@@ -60,4 +72,75 @@ camera_fb_t* camera_capture(){
     }
 
     return fb;
-}
\ No newline at end of file
+}
+
+camera_fb_t* camera_capture_decimated(uint8_t factor){
+    camera_fb_t *fb = camera_capture();
+    if (!fb) {
+        return NULL;
+    }
+
+    captured_width = fb->width;
+    captured_height = fb->height;
+    captured_len = fb->len;
+
+    const int pair = fb->format == PIXFORMAT_YUV422 ? 2 : 1;     // YUV422 keeps whole Y U Y V pairs
+    if (factor > 1 && (fb->format == PIXFORMAT_RGB565 || fb->format == PIXFORMAT_YUV422) &&
+        fb->width % (factor * pair) == 0 && fb->height % factor == 0) {
+        decimate(fb, factor);
+    }
+    return fb;
+}
+
+void camera_release(camera_fb_t *fb){
+    if (!fb) return;
+    fb->width = captured_width;
+    fb->height = captured_height;
+    fb->len = captured_len;
+    esp_camera_fb_return(fb);
+}
+
+/**
+ * Private functions
+ */
+
+// Every output byte lands at or before the bytes it is read from, so the
+// frame shrinks in place in one forward pass
+static void decimate(camera_fb_t *fb, int factor){
+    const int out_width = fb->width / factor;
+    const int out_height = fb->height / factor;
+    const size_t row_bytes = fb->width * 2;
+    uint8_t *dst = fb->buf;
+
+    for (int y = 0; y < out_height; y++) {
+        const uint8_t *src = fb->buf + y * factor * row_bytes;
+
+        if (fb->format == PIXFORMAT_YUV422) {
+            // Y of both kept pixels, U from the first one's pair, V from the second's
+            for (int x = 0; x < out_width; x += 2) {
+                const int second = (x + 1) * factor;
+                const uint8_t *first = src + x * factor * 2;
+                uint8_t y0 = first[0];
+                uint8_t u = first[1];
+                uint8_t y1 = src[second * 2];
+                uint8_t v = src[(second & ~1) * 2 + 3];
+                dst[0] = y0;
+                dst[1] = u;
+                dst[2] = y1;
+                dst[3] = v;
+                dst += 4;
+            }
+        } else {
+            for (int x = 0; x < out_width; x++) {
+                const uint8_t *p = src + x * factor * 2;
+                dst[0] = p[0];
+                dst[1] = p[1];
+                dst += 2;
+            }
+        }
+    }
+
+    fb->width = out_width;
+    fb->height = out_height;
+    fb->len = out_width * out_height * 2;
+}
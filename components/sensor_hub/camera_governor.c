@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "camera_governor.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+static const char *TAG = "governor";
+
+static const char *MODE_NAMES[GOV_MODE_MAX] = { "IDLE", "SEARCH", "TRACK" };
+
+static bool initialized = false;
+static camera_governor_config_t config;
+static gov_mode_t mode = GOV_SEARCH;
+static int64_t mode_since_us;
+static uint32_t period_count;
+
+// Hysteresis counters, reset on every mode change
+static uint16_t confident_frames;   // Detections above acquire_confidence
+static uint16_t missed_frames;      // Frames without any detection
+static uint16_t empty_frames;       // Frames without a detection or motor activity
+
+// Mode bookkeeping read by camera_governor_get_stats() from other tasks
+static uint64_t time_in_mode_us[GOV_MODE_MAX];
+static uint32_t entries[GOV_MODE_MAX];
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * Private function declarations
+ */
+static void enter_mode(gov_mode_t next);
+static void apply_settings(const gov_mode_settings_t *settings);
+
+/**
+ * Public function definitions
+ */
+esp_err_t camera_governor_init(const camera_governor_config_t *cfg) {
+    if(cfg == NULL || cfg->acquire_frames == 0 || cfg->lost_frames == 0 || cfg->idle_frames == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for(int i = 0; i < GOV_MODE_MAX; i++) {
+        if(cfg->modes[i].capture_divider == 0 || cfg->modes[i].decimation == 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if(esp_camera_sensor_get() == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    config = *cfg;
+    portENTER_CRITICAL(&stats_lock);
+    memset(time_in_mode_us, 0, sizeof(time_in_mode_us));
+    memset(entries, 0, sizeof(entries));
+    mode_since_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&stats_lock);
+    enter_mode(GOV_SEARCH);
+    initialized = true;
+    return ESP_OK;
+}
+
+bool camera_governor_should_capture(void) {
+    if(!initialized) return true;
+    return period_count++ % config.modes[mode].capture_divider == 0;
+}
+
+uint8_t camera_governor_decimation(void) {
+    if(!initialized) return 1;
+    return config.modes[mode].decimation;
+}
+
+gov_mode_t camera_governor_update(float confidence, bool driving) {
+    if(!initialized) return mode;
+
+    bool seen = confidence > 0;
+
+    confident_frames = confidence >= config.acquire_confidence ? confident_frames + 1 : 0;
+    missed_frames = seen ? 0 : missed_frames + 1;
+    empty_frames = seen || driving ? 0 : empty_frames + 1;
+
+    switch(mode) {
+        case GOV_IDLE:
+            if(seen || driving) enter_mode(GOV_SEARCH);
+            break;
+        case GOV_SEARCH:
+            if(confident_frames >= config.acquire_frames) {
+                enter_mode(GOV_TRACK);
+            } else if(empty_frames >= config.idle_frames) {
+                enter_mode(GOV_IDLE);
+            }
+            break;
+        case GOV_TRACK:
+            // Motors may still run on the navigator's last command, so
+            // only the vision side decides when tracking is over
+            if(missed_frames >= config.lost_frames) enter_mode(GOV_SEARCH);
+            break;
+        default:
+            break;
+    }
+    return mode;
+}
+
+void camera_governor_get_stats(camera_governor_stats_t *stats) {
+    portENTER_CRITICAL(&stats_lock);
+    stats->mode = mode;
+    memcpy(stats->time_in_mode_us, time_in_mode_us, sizeof(time_in_mode_us));
+    memcpy(stats->entries, entries, sizeof(entries));
+    stats->time_in_mode_us[mode] += esp_timer_get_time() - mode_since_us;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void camera_governor_print_stats(void) {
+    camera_governor_stats_t stats;
+    camera_governor_get_stats(&stats);
+
+    uint64_t total = 0;
+    for(int i = 0; i < GOV_MODE_MAX; i++) {
+        total += stats.time_in_mode_us[i];
+    }
+    if(total == 0) return;
+
+    printf("governor: %s", MODE_NAMES[stats.mode]);
+    for(int i = 0; i < GOV_MODE_MAX; i++) {
+        printf("  %s %llu%% (%lu entries)", MODE_NAMES[i],
+               (unsigned long long)(stats.time_in_mode_us[i] * 100 / total), (unsigned long)stats.entries[i]);
+    }
+    printf("\n");
+}
+
+/**
+ * Private functions
+ */
+static void enter_mode(gov_mode_t next) {
+    // Clock changes block, so they stay outside the lock
+    if(!initialized) {
+        ESP_LOGI(TAG, "Starting in %s", MODE_NAMES[next]);
+        apply_settings(&config.modes[next]);
+    } else if(next != mode) {
+        ESP_LOGI(TAG, "%s -> %s", MODE_NAMES[mode], MODE_NAMES[next]);
+        apply_settings(&config.modes[next]);
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    int64_t now = esp_timer_get_time();
+    time_in_mode_us[mode] += now - mode_since_us;
+    mode_since_us = now;
+    mode = next;
+    entries[next]++;
+    portEXIT_CRITICAL(&stats_lock);
+
+    confident_frames = 0;
+    missed_frames = 0;
+    empty_frames = 0;
+    period_count = 0;       // Capture on the first period of the new mode
+}
+
+// The resolution needs no setup: the control task asks for the decimation
+// factor on every capture
+static void apply_settings(const gov_mode_settings_t *settings) {
+#if CONFIG_PM_ENABLE
+    // Pin the clock for the mode rather than let DFS drop it mid-frame
+    esp_pm_config_t pm = {
+        .max_freq_mhz = settings->cpu_mhz,
+        .min_freq_mhz = settings->cpu_mhz,
+        .light_sleep_enable = false
+    };
+    esp_err_t err = esp_pm_configure(&pm);
+    if(err != ESP_OK) {
+        ESP_LOGW(TAG, "Could not set CPU clock to %d MHz: %s", settings->cpu_mhz, esp_err_to_name(err));
+    }
+#else
+    (void)settings;
+#endif
+}
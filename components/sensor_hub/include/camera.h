@@ -9,7 +9,7 @@
 #define XCLK_FREQ_HZ 20000000
 #define CAMERA_TIMER LEDC_TIMER_1
 #define CAMERA_CHANNEL LEDC_CHANNEL_5
-#define PIXFORMAT PIXFORMAT_RGB565
+#define PIXFORMAT PIXFORMAT_RGB565             // PIXFORMAT_YUV422 for the U/V tracker, see color_stream.h
 #define FRAMESIZE FRAMESIZE_QVGA
 #define QUALITY 12
 #define COUNT 1
@@ -66,6 +66,22 @@ extern "C"
     void register_camera(int clk_freq, const pixformat_t pixel_fromat, const framesize_t frame_size, int quality, const uint8_t fb_count);
     camera_fb_t* camera_capture();
 
+    /**
+     * @brief Capture a frame and shrink it in place to every factor-th pixel of every factor-th row
+     *
+     * Software stand-in for a smaller sensor frame size: esp32-camera drops
+     * RGB565/YUV422 frames whose length differs from the buffer allocated at
+     * init, so the sensor keeps the size given to register_camera(). Frames
+     * in other formats, or not divisible by factor, are returned full size.
+     * Give the frame back with camera_release().
+     */
+    camera_fb_t* camera_capture_decimated(uint8_t factor);
+
+    /**
+     * @brief Restore the captured size of a frame and return it to the driver
+     */
+    void camera_release(camera_fb_t *fb);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,95 @@
+#ifndef CAMERA_GOVERNOR_H
+#define CAMERA_GOVERNOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "common_types.h"
+#include "esp_err.h"
+#include "esp_camera.h"
+
+// Power governor. Moves the camera between three operating points based on
+// how well the target is seen and whether the motors are driven:
+//
+//   IDLE   <-- nothing seen, motors off for idle_frames -- SEARCH
+//   IDLE   -- any detection or motor activity ----------> SEARCH
+//   SEARCH -- confident detection for acquire_frames ---> TRACK
+//   SEARCH <-- no detection for lost_frames ------------- TRACK
+//
+// Each operating point sets the resolution, the capture cadence (every Nth
+// control period) and, when power management is enabled, the CPU clock. The
+// resolution is lowered by decimating the captured frame in software (see
+// camera_capture_decimated()), since esp32-camera cannot change the size of
+// an uncompressed frame after init.
+
+typedef enum {
+    GOV_IDLE,
+    GOV_SEARCH,
+    GOV_TRACK,
+    GOV_MODE_MAX
+} gov_mode_t;
+
+typedef struct {
+    uint8_t decimation;         // Keep every Nth pixel and row of the captured frame
+    uint8_t capture_divider;    // Capture on one control period out of N
+    uint16_t cpu_mhz;           // Applied only with CONFIG_PM_ENABLE
+} gov_mode_settings_t;
+
+typedef struct {
+    gov_mode_settings_t modes[GOV_MODE_MAX];
+    float acquire_confidence;   // Detection confidence needed to count towards TRACK
+    uint8_t acquire_frames;     // Consecutive confident frames to enter TRACK
+    uint8_t lost_frames;        // Consecutive empty frames to drop back to SEARCH
+    uint16_t idle_frames;       // Empty frames with motors off to enter IDLE
+} camera_governor_config_t;
+
+#define CAMERA_GOVERNOR_CONFIG_DEFAULT() {                                          \
+    .modes = {                                                                      \
+        [GOV_IDLE]   = { .decimation = 2, .capture_divider = 10, .cpu_mhz = 80  }, \
+        [GOV_SEARCH] = { .decimation = 2, .capture_divider = 2,  .cpu_mhz = 160 }, \
+        [GOV_TRACK]  = { .decimation = 1, .capture_divider = 1,  .cpu_mhz = 240 }, \
+    },                                                                              \
+    .acquire_confidence = 0.5f,                                                     \
+    .acquire_frames = 2,                                                            \
+    .lost_frames = 8,                                                               \
+    .idle_frames = 50,                                                              \
+}
+
+typedef struct {
+    gov_mode_t mode;
+    uint64_t time_in_mode_us[GOV_MODE_MAX];     // Includes the time in the current mode
+    uint32_t entries[GOV_MODE_MAX];
+} camera_governor_stats_t;
+
+/**
+ * @brief Start in SEARCH and apply its settings. Call after register_camera()
+ */
+esp_err_t camera_governor_init(const camera_governor_config_t *config);
+
+/**
+ * @brief Call once per control period, capture and process a frame only if true
+ */
+bool camera_governor_should_capture(void);
+
+/**
+ * @brief Decimation factor of the current mode, for camera_capture_decimated()
+ */
+uint8_t camera_governor_decimation(void);
+
+/**
+ * @brief Feed the result of a processed frame and switch modes if needed
+ *
+ * Also call it with confidence 0 when a capture failed, so a broken camera
+ * counts as a lost target instead of freezing the current mode.
+ *
+ * @param confidence    0 when nothing was found, up to 1 for a clear target
+ * @param driving       Whether the motors are currently driven
+ */
+gov_mode_t camera_governor_update(float confidence, bool driving);
+
+/**
+ * @brief Copy a consistent snapshot of the mode statistics, from any task
+ */
+void camera_governor_get_stats(camera_governor_stats_t *stats);
+void camera_governor_print_stats(void);
+
+#endif // CAMERA_GOVERNOR_H
@@ -0,0 +1,345 @@
+#include <stddef.h>
+#include "color_stream.h"
+
+// Matches of the row being classified, folded into the frame once per row
+// so the bounding box updates stay out of the pixel loop
+typedef struct {
+    uint32_t sum_x;
+    uint32_t count;
+    int min_x;
+    int max_x;
+    int run_start;
+} row_acc_t;
+
+/**
+ * Private function declarations
+ */
+static hsv_pixel_t rgb_to_hsv(uint8_t r, uint8_t g, uint8_t b);
+static int is_color_in_range(hsv_pixel_t *pixel, const h_range_t *range, uint8_t min_s, uint8_t min_v);
+static void emit_span(color_stream_t *stream, int y, int x, int len);
+static void classify_rgb565_row(color_stream_t *stream, const uint8_t *line, int y, row_acc_t *acc);
+static void classify_yuv422_row(color_stream_t *stream, const uint8_t *line, int y, row_acc_t *acc);
+static void hue_direction(int hue, int32_t *u, int32_t *v);
+static int rgb565_match(const uint8_t *pixel, const h_range_t *target, uint8_t min_s, uint8_t min_v);
+static int yuv_pair_in_sector(const color_stream_t *stream, const uint8_t *pair, int32_t *max_offset, int32_t *delta);
+static int yuv_in_range(int luma, int32_t max_offset, int32_t delta, uint8_t min_s, uint8_t min_v);
+
+static uint8_t threshold_s = MIN_S;
+static uint8_t threshold_v = MIN_V;
+static uint32_t threshold_area = MIN_AREA;
+
+/**
+ * Public function definitions
+ */
+void color_stream_set_thresholds(uint8_t min_s, uint8_t min_v, uint32_t min_area) {
+    threshold_s = min_s;
+    threshold_v = min_v;
+    threshold_area = min_area;
+}
+
+int color_stream_match_pixel(const color_stream_t *stream, const uint8_t *row, int x) {
+    if(stream->format != COLOR_FORMAT_YUV422) {
+        return rgb565_match(row + x * 2, stream->target, stream->min_s, stream->min_v);
+    }
+
+    // The chroma pair is shared with the other pixel of the pair
+    const uint8_t *pair = row + (x & ~1) * 2;
+    int32_t max, delta;
+    return yuv_pair_in_sector(stream, pair, &max, &delta) &&
+           yuv_in_range(pair[(x & 1) * 2], max, delta, stream->min_s, stream->min_v);
+}
+
+esp_err_t color_stream_begin_frame(color_stream_t *stream, int width, int height, const h_range_t *target_color) {
+    if(stream == NULL || target_color == NULL || width <= 0 || height <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    stream->target = target_color;
+    stream->width = width;
+    stream->height = height;
+    stream->row = 0;
+    stream->format = COLOR_FORMAT_RGB565;
+    stream->min_s = threshold_s;
+    stream->min_v = threshold_v;
+    stream->min_area = (uint64_t)threshold_area * width * height / REF_FRAME_PIXELS;
+
+    stream->sum_x = 0;
+    stream->sum_y = 0;
+    stream->count = 0;
+    stream->top_left.x = width;
+    stream->top_left.y = height;
+    stream->bottom_right.x = 0;
+    stream->bottom_right.y = 0;
+
+    stream->spans = NULL;
+    stream->span_capacity = 0;
+    stream->span_count = 0;
+    stream->span_overflow = 0;
+    return ESP_OK;
+}
+
+esp_err_t color_stream_set_format(color_stream_t *stream, color_format_t format) {
+    if(stream == NULL || stream->row != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if(format == COLOR_FORMAT_RGB565) {
+        stream->format = format;
+        return ESP_OK;
+    }
+    if(format != COLOR_FORMAT_YUV422) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if(stream->width % 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // rgb_to_hsv() truncates toward zero: where hue grows away from a
+    // primary (0-30, 60-90, 120-150) hue h covers [h, h + 1), elsewhere
+    // (h - 1, h]. Place the sector edges to match.
+    const h_range_t *target = stream->target;
+    int lo = target->min - target->min / 30 % 2;
+    int hi = target->max + 1 - target->max / 30 % 2;
+    int span = (hi - lo + HSV_H_MAX) % HSV_H_MAX;
+    hue_direction(lo, &stream->sector_lo_u, &stream->sector_lo_v);
+    hue_direction(hi, &stream->sector_hi_u, &stream->sector_hi_v);
+    int32_t turn = stream->sector_lo_u * stream->sector_hi_v - stream->sector_lo_v * stream->sector_hi_u;
+    stream->sector_wide = span == 0 || turn < 0;
+    stream->format = format;
+    return ESP_OK;
+}
+
+void color_stream_set_span_buffer(color_stream_t *stream, mask_span_t *spans, uint32_t capacity) {
+    stream->spans = spans;
+    stream->span_capacity = spans ? capacity : 0;
+    stream->span_count = 0;
+    stream->span_overflow = 0;
+}
+
+esp_err_t color_stream_push_rows(color_stream_t *stream, const uint8_t *rows, int n) {
+    if(stream == NULL || rows == NULL || n < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(stream->row + n > stream->height) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const int width = stream->width;
+
+    for(int i = 0; i < n; i++) {
+        const int y = stream->row + i;
+        const uint8_t *line = rows + i * width * 2;
+        row_acc_t acc = { .sum_x = 0, .count = 0, .min_x = width, .max_x = -1, .run_start = -1 };
+
+        if(stream->format == COLOR_FORMAT_YUV422) {
+            classify_yuv422_row(stream, line, y, &acc);
+        } else {
+            classify_rgb565_row(stream, line, y, &acc);
+        }
+        if(acc.run_start >= 0) emit_span(stream, y, acc.run_start, width - acc.run_start);
+
+        if(acc.count == 0) continue;
+
+        stream->sum_x += acc.sum_x;
+        stream->sum_y += (uint32_t)y * acc.count;
+        stream->count += acc.count;
+        if(acc.min_x < stream->top_left.x)      stream->top_left.x = acc.min_x;
+        if(y < stream->top_left.y)              stream->top_left.y = y;
+        if(acc.max_x > stream->bottom_right.x)  stream->bottom_right.x = acc.max_x;
+        if(y > stream->bottom_right.y)          stream->bottom_right.y = y;
+    }
+
+    stream->row += n;
+    return ESP_OK;
+}
+
+esp_err_t color_stream_end_frame(color_stream_t *stream, color_blob_t *blob) {
+    if(stream == NULL || blob == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(stream->row != stream->height) {
+        blob->area = 0;
+        return ESP_ERR_INVALID_STATE;
+    }
+    if(stream->count < stream->min_area) {
+        // No pixels found
+        blob->area = 0;
+        return ESP_ERR_NOT_FOUND;
+    }
+    // Compute centroid
+    blob->centroid.x = stream->sum_x / stream->count;
+    blob->centroid.y = stream->sum_y / stream->count;
+    blob->top_left = stream->top_left;
+    blob->bottom_right = stream->bottom_right;
+    blob->area = stream->count;
+    return ESP_OK;
+}
+
+/**
+ * Private functions
+ */
+static void emit_span(color_stream_t *stream, int y, int x, int len) {
+    if(stream->spans == NULL) return;
+    if(stream->span_count >= stream->span_capacity) {
+        stream->span_overflow = 1;
+        return;
+    }
+    mask_span_t *span = &stream->spans[stream->span_count++];
+    span->y = y;
+    span->x = x;
+    span->len = len;
+}
+
+static inline void add_pixel(color_stream_t *stream, row_acc_t *acc, int y, int x, int match) {
+    if(match) {
+        acc->sum_x += x;
+        acc->count++;
+        if(x < acc->min_x) acc->min_x = x;
+        acc->max_x = x;
+        if(acc->run_start < 0) acc->run_start = x;
+    } else if(acc->run_start >= 0) {
+        emit_span(stream, y, acc->run_start, x - acc->run_start);
+        acc->run_start = -1;
+    }
+}
+
+static void classify_rgb565_row(color_stream_t *stream, const uint8_t *line, int y, row_acc_t *acc) {
+    const h_range_t *target = stream->target;
+    const uint8_t min_s = stream->min_s;
+    const uint8_t min_v = stream->min_v;
+
+    for(int x = 0; x < stream->width; x++) {
+        add_pixel(stream, acc, y, x, rgb565_match(line + x * 2, target, min_s, min_v));
+    }
+}
+
+static inline int rgb565_match(const uint8_t *pixel, const h_range_t *target, uint8_t min_s, uint8_t min_v) {
+    uint16_t rgb = (pixel[0] << 8) | pixel[1];
+
+    uint8_t r = (rgb & 0xF800) >> 8;
+    uint8_t g = (rgb & 0x07E0) >> 3;
+    uint8_t b = (rgb & 0x001F) << 3;
+
+    hsv_pixel_t hsv = rgb_to_hsv(r, g, b);
+    return is_color_in_range(&hsv, target, min_s, min_v);
+}
+
+// V = max(R, G, B) = Y + max offset, S = (max - min) / V, compared as
+// delta * 255 >= min_s * V like rgb_to_hsv() and is_color_in_range()
+static inline int yuv_in_range(int luma, int32_t max_offset, int32_t delta, uint8_t min_s, uint8_t min_v) {
+    int value = luma + (max_offset >> 8);
+    if(value > 255) value = 255;
+    return value >= min_v && delta * 255 >= ((int32_t)min_s * value) << 8;
+}
+
+// Hue sector test of one Y0 U Y1 V pair. When it passes, also returns the
+// largest R/G/B offset from Y and the offset spread for yuv_in_range().
+static inline int yuv_pair_in_sector(const color_stream_t *stream, const uint8_t *pair, int32_t *max_offset, int32_t *delta) {
+    int32_t u = pair[1] - 128;
+    int32_t v = pair[3] - 128;
+
+    // Counter-clockwise of the first boundary and clockwise of the second
+    int after_lo = stream->sector_lo_u * v - stream->sector_lo_v * u >= 0;
+    int before_hi = u * stream->sector_hi_v - v * stream->sector_hi_u > 0;
+    if(stream->sector_wide ? !(after_lo || before_hi) : !(after_lo && before_hi)) {
+        return 0;
+    }
+
+    // R - Y, G - Y and B - Y in 1/256 steps (full-range BT.601)
+    int32_t dr = 359 * v;
+    int32_t dg = -88 * u - 183 * v;
+    int32_t db = 454 * u;
+    int32_t max = dr > dg ? (dr > db ? dr : db) : (dg > db ? dg : db);
+    int32_t min = dr < dg ? (dr < db ? dr : db) : (dg < db ? dg : db);
+    *delta = max - min;
+    *max_offset = max < 0 ? 0 : max;    // Only negative through rounding
+    return 1;
+}
+
+static void classify_yuv422_row(color_stream_t *stream, const uint8_t *line, int y, row_acc_t *acc) {
+    const uint8_t min_s = stream->min_s;
+    const uint8_t min_v = stream->min_v;
+
+    for(int x = 0; x < stream->width; x += 2) {
+        const uint8_t *pair = line + x * 2;
+        int32_t max, delta;
+
+        if(!yuv_pair_in_sector(stream, pair, &max, &delta)) {
+            add_pixel(stream, acc, y, x, 0);
+            add_pixel(stream, acc, y, x + 1, 0);
+            continue;
+        }
+        add_pixel(stream, acc, y, x, yuv_in_range(pair[0], max, delta, min_s, min_v));
+        add_pixel(stream, acc, y, x + 1, yuv_in_range(pair[2], max, delta, min_s, min_v));
+    }
+}
+
+// (U, V) direction of a fully saturated color of the given hue, x1024.
+// Any color of that hue is gray plus a multiple of it, and gray has no chroma.
+static void hue_direction(int hue, int32_t *u, int32_t *v) {
+    hue %= HSV_H_MAX;
+    float f = (hue % 30) / 30.0f;
+    float r, g, b;
+
+    switch(hue / 30) {
+        case 0:  r = 1;     g = f;     b = 0;     break;
+        case 1:  r = 1 - f; g = 1;     b = 0;     break;
+        case 2:  r = 0;     g = 1;     b = f;     break;
+        case 3:  r = 0;     g = 1 - f; b = 1;     break;
+        case 4:  r = f;     g = 0;     b = 1;     break;
+        default: r = 1;     g = 0;     b = 1 - f; break;
+    }
+    *u = (int32_t)((-0.168736f * r - 0.331264f * g + 0.5f * b) * 1024);
+    *v = (int32_t)((0.5f * r - 0.418688f * g - 0.081312f * b) * 1024);
+}
+
+static hsv_pixel_t rgb_to_hsv(uint8_t r, uint8_t g, uint8_t b) {
+    hsv_pixel_t hsv;
+    uint8_t min = r < g ? (r < b ? r : b) : (g < b ? g : b);
+    uint8_t max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+    uint8_t delta = max - min;
+
+    // Value calculation
+    hsv.v = max;
+
+    if (max == 0 || delta == 0) {
+        hsv.s = 0;
+        hsv.h = 0;
+        return hsv;
+    }
+
+    // Saturation calculation
+    hsv.s = (uint8_t)((delta * 255) / max);
+
+    // Hue calculation
+    int32_t h_temp;
+
+    if (max == r) {
+        h_temp = (30 * (g - b)) / delta;
+    } else if (max == g) {
+        h_temp = 60 + (30 * (b - r)) / delta;
+    } else {
+        h_temp = 120 + (30 * (r - g)) / delta;
+    }
+
+    if (h_temp < 0)    h_temp += 180;
+    if (h_temp >= 180) h_temp -= 180;
+
+    hsv.h = (uint8_t)h_temp;
+
+    return hsv;
+}
+
+static int is_color_in_range(hsv_pixel_t *pixel, const h_range_t *range, uint8_t min_s, uint8_t min_v) {
+    if(pixel->s < min_s || pixel->v < min_v) return 0;
+
+    if(range->min > range->max){
+        if (pixel->h >= range->min || pixel->h <= range->max) return 1;
+        else return 0;
+    }
+
+    if (pixel->h >= range->min && pixel->h <= range->max) {
+        return 1;
+    }
+
+    return 0;
+}
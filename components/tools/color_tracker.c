@@ -1,68 +1,61 @@
 #include <stdio.h>
+#include <string.h>
 #include "color_tracker.h"
 
-/**
- * Private function declarations
- */
-static hsv_pixel_t rgb_to_hsv(uint8_t r, uint8_t g, uint8_t b);
-static int is_color_in_range(hsv_pixel_t *pixel, const h_range_t *range);
+// Internal SRAM line buffer (statics are placed in DRAM, never PSRAM).
+// Each strip is pulled out of the PSRAM frame buffer with one sequential
+// memcpy, then classified from SRAM so the per-pixel loop never misses the
+// PSRAM cache.
+static uint8_t strip_buf[STRIP_LINES * STRIP_MAX_WIDTH * 2];
 
 /**
  * Public function definitions
  */
 esp_err_t compute_blob(camera_fb_t *fb, const h_range_t *target_color, color_blob_t *blob) {
+    return compute_blob_with_mask(fb, target_color, blob, NULL, 0, NULL, NULL);
+}
 
-    int sum_x = 0;
-    int sum_y = 0;
-    int count = 0;
-
-    point_t top_left = { .x = fb->width, .y = fb->height };
-    point_t bottom_right = { .x = 0, .y = 0 };
-
-    if (fb->format != PIXFORMAT_RGB565) {
-        printf("Error: format must be RGB565\n");
-        return ESP_FAIL;
+esp_err_t compute_blob_with_mask(camera_fb_t *fb, const h_range_t *target_color, color_blob_t *blob,
+                                 mask_span_t *spans, uint32_t capacity, uint32_t *span_count,
+                                 uint8_t *span_overflow) {
+    color_stream_t stream;
+    color_format_t format;
+    if(span_count) *span_count = 0;
+    if(span_overflow) *span_overflow = 0;
+
+    // YUV422 is classified in U/V directly, without the HSV conversion
+    switch(fb->format) {
+        case PIXFORMAT_RGB565: format = COLOR_FORMAT_RGB565; break;
+        case PIXFORMAT_YUV422: format = COLOR_FORMAT_YUV422; break;
+        default:
+            printf("Error: format must be RGB565 or YUV422\n");
+            return ESP_FAIL;
     }
 
-    for(int y = 0; y < fb->height; y++) {
-        for(int x = 0; x < fb->width; x++) {
-            int pixel_index = (y * fb->width + x) * 2;
-
-            uint8_t byte1 = fb->buf[pixel_index];
-            uint8_t byte2 = fb->buf[pixel_index + 1];
-            uint16_t pixel = (byte1 << 8) | byte2;
+    esp_err_t err = color_stream_begin_frame(&stream, fb->width, fb->height, target_color);
+    if(err == ESP_OK) err = color_stream_set_format(&stream, format);
+    if(err != ESP_OK) return err;
+    color_stream_set_span_buffer(&stream, spans, capacity);
 
-            uint8_t r = (pixel & 0xF800) >> 8;
-            uint8_t g = (pixel & 0x07E0) >> 3;
-            uint8_t b = (pixel & 0x001F) << 3;
+    // Both formats are 2 bytes per pixel
+    const size_t row_bytes = fb->width * 2;
+    const int use_strip_buf = fb->width <= STRIP_MAX_WIDTH;
 
-            hsv_pixel_t hsv = rgb_to_hsv(r, g, b);
+    for(int y = 0; y < fb->height; y += STRIP_LINES) {
+        int n = fb->height - y;
+        if(n > STRIP_LINES) n = STRIP_LINES;
 
-            if(is_color_in_range(&hsv, target_color)) {
-                
-                sum_x += x;
-                sum_y += y;
-                count++;
-                // Update bounding box
-                if(x < top_left.x)      top_left.x = x;
-                if(y < top_left.y)      top_left.y = y;
-                if(x > bottom_right.x)  bottom_right.x = x;
-                if(y > bottom_right.y)  bottom_right.y = y;
-            } 
+        const uint8_t *rows = fb->buf + y * row_bytes;
+        if(use_strip_buf) {
+            memcpy(strip_buf, rows, n * row_bytes);
+            rows = strip_buf;
         }
+        color_stream_push_rows(&stream, rows, n);
     }
-    if(count < MIN_AREA) {
-        // No pixels found
-        blob->area = 0;
-        return ESP_ERR_NOT_FOUND;
-    }
-    // Compute centroid
-    blob->centroid.x = sum_x / count;
-    blob->centroid.y = sum_y / count;
-    blob->top_left = top_left;
-    blob->bottom_right = bottom_right;
-    blob->area = count;
-    return ESP_OK;
+
+    if(span_count) *span_count = stream.span_count;
+    if(span_overflow) *span_overflow = stream.span_overflow;
+    return color_stream_end_frame(&stream, blob);
 }
 
 void print_blob_info(color_blob_t *blob) {
@@ -73,59 +66,3 @@ void print_blob_info(color_blob_t *blob) {
            blob->bottom_right.x, blob->bottom_right.y);
     printf(" Area (in pixels): %lu\n", blob->area);
 }
-
-/**
- * Private functions
- */
-
-static hsv_pixel_t rgb_to_hsv(uint8_t r, uint8_t g, uint8_t b) {
-    hsv_pixel_t hsv;
-    uint8_t min = r < g ? (r < b ? r : b) : (g < b ? g : b);
-    uint8_t max = r > g ? (r > b ? r : b) : (g > b ? g : b);
-    uint8_t delta = max - min;
-
-    // Value calculation
-    hsv.v = max;
-
-    if (max == 0 || delta == 0) {
-        hsv.s = 0;
-        hsv.h = 0;
-        return hsv;
-    }
-
-    // Saturation calculation
-    hsv.s = (uint8_t)((delta * 255) / max);
-
-    // Hue calculation
-    int32_t h_temp; 
-
-    if (max == r) {
-        h_temp = (30 * (g - b)) / delta;
-    } else if (max == g) {
-        h_temp = 60 + (30 * (b - r)) / delta;
-    } else {
-        h_temp = 120 + (30 * (r - g)) / delta;
-    }
-
-    if (h_temp < 0)    h_temp += 180;
-    if (h_temp >= 180) h_temp -= 180;
-
-    hsv.h = (uint8_t)h_temp;
-
-    return hsv;
-}
-
-static int is_color_in_range(hsv_pixel_t *pixel, const h_range_t *range) {
-    if(pixel->s < MIN_S || pixel->v < MIN_V) return 0;
-
-    if(range->min > range->max){
-        if (pixel->h >= range->min || pixel->h <= range->max) return 1;
-        else return 0;
-    }
-
-    if (pixel->h >= range->min && pixel->h <= range->max) {
-        return 1;
-    }
-
-    return 0;
-}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#ifndef COLOR_STREAM_H
+#define COLOR_STREAM_H
+
+#include <stdint.h>
+#include "common_types.h"
+#include "esp_err.h"
+
+// Streaming color tracker. The frame is fed in strips of whole rows so the
+// caller decides where the pixels live (PSRAM frame buffer, SRAM line
+// buffer, synthetic host data). Depends only on common_types.h and
+// esp_err.h so it also builds on the host (see host/include).
+//
+// Two pixel formats are classified natively. RGB565 goes through the HSV
+// conversion. YUV422 is classified in the sensor's own color space: HSV
+// hue is linear in RGB apart from a gray offset, and gray has no chroma,
+// so a hue range is exactly an angular sector of the U/V plane. Value and
+// saturation follow from Y and the chroma pair's largest and smallest
+// R/G/B offsets. Each U/V pair is tested once for the two pixels sharing
+// it, and nothing is divided per pixel.
+
+#define MIN_S 100
+#define MIN_V 50
+#define HSV_H_MAX 180
+
+#define MIN_AREA 500
+
+typedef enum {
+    COLOR_FORMAT_RGB565,        // Big-endian, 2 bytes per pixel
+    COLOR_FORMAT_YUV422,        // Y0 U Y1 V, one chroma pair per two pixels
+} color_format_t;
+
+// One horizontal run of matching pixels, as produced by the classifier.
+// Three little-endian uint16 fields, sent as-is by the /mask endpoint.
+typedef struct {
+    uint16_t y;
+    uint16_t x;
+    uint16_t len;
+} mask_span_t;
+
+typedef struct {
+    const h_range_t *target;
+    int width;
+    int height;
+    int row;            // Next row expected by color_stream_push_rows()
+    color_format_t format;
+
+    // YUV422 hue sector: directions of the range's first and one-past-last
+    // hue in the (U, V) plane, counter-clockwise from sector_lo to sector_hi
+    int32_t sector_lo_u;
+    int32_t sector_lo_v;
+    int32_t sector_hi_u;
+    int32_t sector_hi_v;
+    uint8_t sector_wide;        // Sector spans more than half a turn
+
+    // Thresholds latched at begin_frame so they never change mid-frame
+    uint8_t min_s;
+    uint8_t min_v;
+    uint32_t min_area;          // Already scaled to this frame's size
+
+    uint32_t sum_x;
+    uint32_t sum_y;
+    uint32_t count;
+    point_t top_left;
+    point_t bottom_right;
+
+    // Optional run-length mask output, see color_stream_set_span_buffer()
+    mask_span_t *spans;
+    uint32_t span_capacity;
+    uint32_t span_count;
+    uint8_t span_overflow;      // Set when runs were dropped for lack of space
+} color_stream_t;
+
+/**
+ * @brief Set the saturation/value gates and minimum blob area
+ *
+ * Takes effect at the next color_stream_begin_frame(). Defaults are
+ * MIN_S, MIN_V and MIN_AREA. min_area is counted in QVGA pixels and scaled
+ * to the frame size, so the same setting holds when the resolution changes.
+ */
+void color_stream_set_thresholds(uint8_t min_s, uint8_t min_v, uint32_t min_area);
+
+/**
+ * @brief Classify pixel x of one row in the frame's pixel format
+ *
+ * For sparse samplers (line follower) that do not push the whole frame. Uses
+ * the target, format and thresholds set up for the frame; rows may be
+ * visited in any order.
+ *
+ * @param row   width * 2 bytes
+ */
+int color_stream_match_pixel(const color_stream_t *stream, const uint8_t *row, int x);
+
+/**
+ * @brief Reset the accumulators for a new width x height RGB565 frame
+ */
+esp_err_t color_stream_begin_frame(color_stream_t *stream, int width, int height, const h_range_t *target_color);
+
+/**
+ * @brief Select the pixel format of the rows pushed for this frame
+ *
+ * Call after color_stream_begin_frame(). YUV422 frames need an even width.
+ */
+esp_err_t color_stream_set_format(color_stream_t *stream, color_format_t format);
+
+/**
+ * @brief Record every run of matching pixels into spans during classification
+ *
+ * Call after color_stream_begin_frame(), which clears the buffer. Runs past
+ * capacity are dropped and flagged in span_overflow.
+ */
+void color_stream_set_span_buffer(color_stream_t *stream, mask_span_t *spans, uint32_t capacity);
+
+/**
+ * @brief Classify n rows in the frame's pixel format
+ *
+ * @param rows  n * width * 2 bytes, the next rows of the frame in order
+ */
+esp_err_t color_stream_push_rows(color_stream_t *stream, const uint8_t *rows, int n);
+
+/**
+ * @brief Finish the frame and fill in the blob
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if fewer than min_area pixels matched,
+ *         ESP_ERR_INVALID_STATE if not every row was pushed
+ */
+esp_err_t color_stream_end_frame(color_stream_t *stream, color_blob_t *blob);
+
+#endif // COLOR_STREAM_H
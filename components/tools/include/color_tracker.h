@@ -4,53 +4,26 @@
 #include "common_types.h"
 #include "esp_err.h"
 #include "camera.h"
+#include "color_stream.h"
 
-// Your declarations here
-#define MIN_S 100
-#define MIN_V 50
-#define HSV_H_MAX 180
-
-#define MIN_AREA 500
-
-typedef struct {
-    uint8_t h;
-    uint8_t s;
-    uint8_t v;
-} hsv_pixel_t;
-
-typedef struct {
-    uint8_t min;
-    uint8_t max;
-} h_range_t;
-
-typedef struct {
-    int x;
-    int y;
-} point_t;
-
-typedef struct {
-    // The "Centroid" (for steering)
-    point_t centroid;
-
-    // The "Bounding Box" (for visualizing or collision logic)
-    point_t top_left;     // Upper Left point
-    point_t bottom_right; // Lower Right point
-
-    // The "Mass" (for distance estimation)
-    uint32_t area;     // Total number of valid pixels
-} color_blob_t;
-
-// Define color ranges in HSV space
-static const h_range_t COLOR_RED   = { .min = 170,   .max = 10  };
-
-static const h_range_t COLOR_ORANGE    = { .min = 11,  .max = 25  };
-static const h_range_t COLOR_YELLOW    = { .min = 26,  .max = 34  };
-static const h_range_t COLOR_GREEN     = { .min = 35,  .max = 85  };
-static const h_range_t COLOR_CYAN      = { .min = 86,  .max = 99  };
-static const h_range_t COLOR_BLUE      = { .min = 100, .max = 130 };
-static const h_range_t COLOR_PURPLE    = { .min = 131, .max = 169 };
+// Rows copied from the PSRAM frame buffer into internal SRAM per strip
+#define STRIP_LINES 8
+#define STRIP_MAX_WIDTH 320
 
+/**
+ * @brief Find the target_color blob in an RGB565 or YUV422 frame
+ */
 esp_err_t compute_blob(camera_fb_t *fb, const h_range_t *target_color, color_blob_t *blob) ;
+
+/**
+ * @brief compute_blob() that also returns the match mask as run-length spans
+ *
+ * @param span_count     Receives the number of spans written to spans
+ * @param span_overflow  Optional, set when runs were dropped for lack of capacity
+ */
+esp_err_t compute_blob_with_mask(camera_fb_t *fb, const h_range_t *target_color, color_blob_t *blob,
+                                 mask_span_t *spans, uint32_t capacity, uint32_t *span_count,
+                                 uint8_t *span_overflow);
 void print_blob_info(color_blob_t *blob);
 
 #endif // COLOR_TRACKER_H
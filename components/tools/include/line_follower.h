@@ -0,0 +1,56 @@
+#ifndef LINE_FOLLOWER_H
+#define LINE_FOLLOWER_H
+
+#include <stdint.h>
+#include "common_types.h"
+#include "color_stream.h"
+#include "esp_err.h"
+
+// Floor-tape line following. Only a few scanlines near the bottom of the
+// frame are classified; the tape center on each one is fitted with a
+// straight line. Like color_stream.c it builds on the host as well.
+
+#define LINE_MAX_SCANLINES 16
+
+typedef struct {
+    int scanlines;      // Rows sampled, at most LINE_MAX_SCANLINES
+    int bottom_margin;  // Rows skipped above the bottom edge
+    int spacing;        // Rows between two scanlines
+    int max_gap;        // Unmatched pixels bridged inside one tape run
+    int min_width;      // Narrower runs are rejected as noise
+} line_follower_config_t;
+
+#define LINE_FOLLOWER_CONFIG_DEFAULT() { \
+    .scanlines = 6,                      \
+    .bottom_margin = 4,                  \
+    .spacing = 12,                       \
+    .max_gap = 2,                        \
+    .min_width = 4,                      \
+}
+
+typedef struct {
+    float offset_px;    // Tape center at the bottom row minus the image center, positive to the right
+    float heading_rad;  // Tape direction relative to straight ahead, positive when it bends right
+    int valid_lines;    // Scanlines that found the tape
+} line_fit_t;
+
+/**
+ * @brief Find the tape on the configured scanlines and fit a line through it
+ *
+ * The result is also written as a blob so the steering code can use it
+ * unchanged: the centroid is the fitted tape center on the top scanline (the
+ * look-ahead point), the box spans the tape edges that were found and the
+ * area is the number of tape pixels sampled.
+ *
+ * @param buf     width * height * 2 bytes in the given format
+ * @param format  Classified like color_stream does, YUV422 in U/V directly
+ * @param fit     Optional
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if fewer than two scanlines saw the tape,
+ *         or the error of color_stream_set_format() for an unusable format
+ */
+esp_err_t line_follower_process(const uint8_t *buf, int width, int height, color_format_t format,
+                                const h_range_t *tape_color, const line_follower_config_t *config,
+                                color_blob_t *blob, line_fit_t *fit);
+
+#endif // LINE_FOLLOWER_H
@@ -0,0 +1,67 @@
+#ifndef VISUAL_ODOMETRY_H
+#define VISUAL_ODOMETRY_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Camera-only motion estimate. Each frame is reduced to a small 7-bit luma
+// image, 8x8 blocks are matched against the previous frame with a
+// sum-of-absolute-differences search that handles four pixels per 32-bit
+// word, and the block vectors are fitted with a translation + scale +
+// rotation model. Like color_stream.c it builds on the host as well.
+
+#define VO_W 80                     // Luma image size (QVGA / 4)
+#define VO_H 60
+#define VO_STRIDE (VO_W + 4)        // One spare word per row for shifted loads
+#define VO_BLOCK 8
+#define VO_MAX_RADIUS 4             // Largest search radius in luma pixels
+
+typedef struct {
+    int max_blocks;         // Cycle budget: blocks matched per frame
+    int search_radius;      // +/- luma pixels, at most VO_MAX_RADIUS
+    int min_texture;        // Flatter blocks carry no motion information and are skipped
+} vo_config_t;
+
+#define VO_CONFIG_DEFAULT() { \
+    .max_blocks = 24,         \
+    .search_radius = 3,       \
+    .min_texture = 200,       \
+}
+
+typedef struct {
+    float dx;               // Global image translation, luma pixels per frame
+    float dy;
+    float scale;            // Expansion per frame (positive when approaching)
+    float rotation_rad;     // In-plane rotation per frame
+    float confidence;       // 0-1, share of matched blocks that agree with the fit
+    int blocks;             // Blocks matched this frame
+} vo_motion_t;
+
+typedef struct {
+    vo_config_t config;
+    uint32_t luma[2][VO_H * VO_STRIDE / 4];
+    int current;            // Index of the newest luma image
+    int frames;
+} visual_odometry_t;
+
+esp_err_t vo_init(visual_odometry_t *vo, const vo_config_t *config);
+
+/**
+ * @brief Estimate the motion between the previous frame and this one
+ *
+ * Work is bounded by config.max_blocks * (2 * search_radius + 1)^2 block
+ * comparisons of 16 words each, independent of the scene.
+ *
+ * @param buf   Big-endian RGB565 frame, width and height multiples of VO_W and VO_H
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND on the first frame or when no block had
+ *         enough texture, ESP_ERR_INVALID_SIZE for an unsupported frame size
+ */
+esp_err_t vo_process_rgb565(visual_odometry_t *vo, const uint8_t *buf, int width, int height, vo_motion_t *motion);
+
+/**
+ * @brief vo_process_rgb565() for a Y0 U Y1 V frame, reading the luma bytes directly
+ */
+esp_err_t vo_process_yuv422(visual_odometry_t *vo, const uint8_t *buf, int width, int height, vo_motion_t *motion);
+
+#endif // VISUAL_ODOMETRY_H
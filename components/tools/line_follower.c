@@ -0,0 +1,128 @@
+#include <math.h>
+#include <stddef.h>
+#include "line_follower.h"
+
+typedef struct {
+    int left;
+    int right;
+} tape_run_t;
+
+/**
+ * Private function declarations
+ */
+static int find_tape(const color_stream_t *stream, const uint8_t *row,
+                     const line_follower_config_t *config, tape_run_t *run);
+
+/**
+ * Public function definitions
+ */
+esp_err_t line_follower_process(const uint8_t *buf, int width, int height, color_format_t format,
+                                const h_range_t *tape_color, const line_follower_config_t *config,
+                                color_blob_t *blob, line_fit_t *fit) {
+    if(buf == NULL || tape_color == NULL || config == NULL || blob == NULL ||
+       config->scanlines < 2 || config->scanlines > LINE_MAX_SCANLINES || config->spacing <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Only used to classify single pixels, no rows are pushed
+    color_stream_t stream;
+    esp_err_t err = color_stream_begin_frame(&stream, width, height, tape_color);
+    if(err == ESP_OK) err = color_stream_set_format(&stream, format);
+    if(err != ESP_OK) {
+        if(fit) fit->valid_lines = 0;
+        blob->area = 0;
+        return err;
+    }
+
+    // Least-squares fit of x = a + b * y over the tape centers
+    float sum_y = 0, sum_x = 0, sum_yy = 0, sum_yx = 0;
+    int n = 0;
+    int y_top = height, y_bottom = 0;
+    int left = width, right = 0;
+    uint32_t area = 0;
+
+    for(int i = 0; i < config->scanlines; i++) {
+        int y = height - 1 - config->bottom_margin - i * config->spacing;
+        if(y < 0) break;
+
+        tape_run_t run;
+        if(!find_tape(&stream, buf + y * width * 2, config, &run)) continue;
+
+        float center = (run.left + run.right) / 2.0f;
+        sum_y += y;
+        sum_x += center;
+        sum_yy += (float)y * y;
+        sum_yx += y * center;
+        n++;
+
+        if(y < y_top)           y_top = y;
+        if(y > y_bottom)        y_bottom = y;
+        if(run.left < left)     left = run.left;
+        if(run.right > right)   right = run.right;
+        area += run.right - run.left + 1;
+    }
+
+    if(fit) fit->valid_lines = n;
+    if(n < 2) {
+        blob->area = 0;
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    float b = (n * sum_yx - sum_y * sum_x) / (n * sum_yy - sum_y * sum_y);
+    float a = (sum_x - b * sum_y) / n;
+
+    if(fit) {
+        fit->offset_px = a + b * (height - 1) - width / 2.0f;
+        // x grows by -b per row further ahead (rows count down the image)
+        fit->heading_rad = atanf(-b);
+    }
+
+    // Look-ahead point on the top scanline, the steering code's "centroid"
+    int look_x = (int)lroundf(a + b * y_top);
+    if(look_x < 0)          look_x = 0;
+    if(look_x > width - 1)  look_x = width - 1;
+
+    blob->centroid.x = look_x;
+    blob->centroid.y = y_top;
+    blob->top_left.x = left;
+    blob->top_left.y = y_top;
+    blob->bottom_right.x = right;
+    blob->bottom_right.y = y_bottom;
+    blob->area = area;
+    return ESP_OK;
+}
+
+/**
+ * Private functions
+ */
+
+// Widest run of tape pixels on one row, bridging gaps up to max_gap pixels
+static int find_tape(const color_stream_t *stream, const uint8_t *row,
+                     const line_follower_config_t *config, tape_run_t *run) {
+    const int width = stream->width;
+    int best_width = 0;
+    int start = -1;
+    int last = -1;
+
+    for(int x = 0; x <= width; x++) {
+        int match = 0;
+        if(x < width) {
+            match = color_stream_match_pixel(stream, row, x);
+        }
+
+        if(match) {
+            if(start < 0) start = x;
+            last = x;
+        } else if(start >= 0 && (x - last > config->max_gap || x == width)) {
+            int run_width = last - start + 1;
+            if(run_width >= config->min_width && run_width > best_width) {
+                best_width = run_width;
+                run->left = start;
+                run->right = last;
+            }
+            start = -1;
+        }
+    }
+
+    return best_width > 0;
+}
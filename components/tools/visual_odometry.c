@@ -0,0 +1,272 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "visual_odometry.h"
+
+// Block grid: 8x8 blocks on a word-aligned 8-pixel pitch, kept VO_MAX_RADIUS
+// away from the edges so every candidate stays inside the luma image.
+#define GRID_X0     VO_MAX_RADIUS
+#define GRID_Y0     VO_MAX_RADIUS
+#define GRID_COLS   ((VO_W - 2 * VO_MAX_RADIUS) / VO_BLOCK)
+#define GRID_ROWS   ((VO_H - 2 * VO_MAX_RADIUS) / VO_BLOCK)
+#define GRID_BLOCKS (GRID_COLS * GRID_ROWS)
+#define GRID_STEP   7       // Coprime with GRID_BLOCKS, spreads a partial budget over the image
+
+#define STRIDE_WORDS (VO_STRIDE / 4)
+#define INLIER_PX    1.0f
+
+typedef struct {
+    float rx, ry;           // Block center relative to the image center
+    float vx, vy;           // Image motion of the block
+} block_vector_t;
+
+/**
+ * Private function declarations
+ */
+static esp_err_t process(visual_odometry_t *vo, const uint8_t *buf, int width, int height, int yuv, vo_motion_t *motion);
+static void extract_luma(uint8_t *luma, const uint8_t *buf, int width, int height, int yuv);
+static uint32_t load_shifted(const uint32_t *row, int x);
+static uint32_t sad4(uint32_t a, uint32_t b);
+static uint32_t block_sad(const uint32_t *cur, int cx, int cy, const uint32_t *prev, int px, int py);
+static int match_block(const visual_odometry_t *vo, int bx, int by, block_vector_t *vec);
+static void fit_motion(const block_vector_t *vecs, const uint8_t *use, int n, vo_motion_t *motion);
+
+/**
+ * Public function definitions
+ */
+esp_err_t vo_init(visual_odometry_t *vo, const vo_config_t *config) {
+    if(vo == NULL || config == NULL || config->search_radius < 1 ||
+       config->search_radius > VO_MAX_RADIUS || config->max_blocks < 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(vo, 0, sizeof(*vo));
+    vo->config = *config;
+    return ESP_OK;
+}
+
+esp_err_t vo_process_rgb565(visual_odometry_t *vo, const uint8_t *buf, int width, int height, vo_motion_t *motion) {
+    return process(vo, buf, width, height, 0, motion);
+}
+
+esp_err_t vo_process_yuv422(visual_odometry_t *vo, const uint8_t *buf, int width, int height, vo_motion_t *motion) {
+    return process(vo, buf, width, height, 1, motion);
+}
+
+/**
+ * Private functions
+ */
+static esp_err_t process(visual_odometry_t *vo, const uint8_t *buf, int width, int height, int yuv, vo_motion_t *motion) {
+    if(vo == NULL || buf == NULL || motion == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if(width < VO_W || height < VO_H || width % VO_W || height % VO_H) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(motion, 0, sizeof(*motion));
+    vo->current ^= 1;
+    extract_luma((uint8_t *)vo->luma[vo->current], buf, width, height, yuv);
+    if(vo->frames++ == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    block_vector_t vecs[GRID_BLOCKS];
+    uint8_t use[GRID_BLOCKS];
+    int n = 0;
+    int budget = vo->config.max_blocks < GRID_BLOCKS ? vo->config.max_blocks : GRID_BLOCKS;
+    int start = (vo->frames * GRID_STEP) % GRID_BLOCKS;    // Rotate coverage between frames
+
+    for(int i = 0; i < GRID_BLOCKS && motion->blocks < budget; i++) {
+        int index = (start + i * GRID_STEP) % GRID_BLOCKS;
+        int bx = GRID_X0 + (index % GRID_COLS) * VO_BLOCK;
+        int by = GRID_Y0 + (index / GRID_COLS) * VO_BLOCK;
+
+        int result = match_block(vo, bx, by, &vecs[n]);
+        if(result < 0) continue;        // Too flat, costs one texture check only
+        motion->blocks++;
+        if(result > 0) n++;             // Otherwise matched but ambiguous
+    }
+
+    if(n < 3) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Fit on every vector, then refit on the ones that agree with it
+    memset(use, 1, n);
+    fit_motion(vecs, use, n, motion);
+
+    int inliers = 0;
+    for(int i = 0; i < n; i++) {
+        float px = motion->dx + motion->scale * vecs[i].rx - motion->rotation_rad * vecs[i].ry;
+        float py = motion->dy + motion->scale * vecs[i].ry + motion->rotation_rad * vecs[i].rx;
+        use[i] = fabsf(vecs[i].vx - px) < INLIER_PX && fabsf(vecs[i].vy - py) < INLIER_PX;
+        inliers += use[i];
+    }
+    if(inliers >= 3) {
+        fit_motion(vecs, use, n, motion);
+    }
+
+    motion->confidence = (float)inliers / motion->blocks;
+    return ESP_OK;
+}
+
+// 7-bit luma (top bit left free for the SWAR guard), averaging two
+// neighboring pixels per sample to take the edge off sensor noise. At
+// width == VO_W there is no neighbor inside the sample's cell (the last one
+// would be past the row), so the pixel is counted twice instead. Both
+// formats have pixel x at byte 2x; in YUV422 that byte is its Y.
+static void extract_luma(uint8_t *luma, const uint8_t *buf, int width, int height, int yuv) {
+    const int step_x = width / VO_W;
+    const int step_y = height / VO_H;
+    const int neighbor = step_x > 1 ? 2 : 0;     // Byte offset of the second pixel
+
+    for(int y = 0; y < VO_H; y++) {
+        const uint8_t *src = buf + (y * step_y + step_y / 2) * width * 2;
+        uint8_t *dst = luma + y * VO_STRIDE;
+
+        for(int x = 0; x < VO_W; x++) {
+            const uint8_t *p = src + (x * step_x) * 2;
+            uint32_t sum = 0;
+            for(int k = 0; k < 2; k++) {
+                if(yuv) {
+                    sum += p[k * neighbor];
+                    continue;
+                }
+                uint16_t pixel = (p[k * neighbor] << 8) | p[k * neighbor + 1];
+                uint32_t r = (pixel & 0xF800) >> 8;
+                uint32_t g = (pixel & 0x07E0) >> 3;
+                uint32_t b = (pixel & 0x001F) << 3;
+                sum += (2 * r + 5 * g + b) >> 3;
+            }
+            dst[x] = sum >> 2;
+        }
+        memset(dst + VO_W, 0, VO_STRIDE - VO_W);
+    }
+}
+
+// Four bytes starting at byte x of a row (little-endian, as on ESP32 and
+// x86), built from two aligned loads instead of a byte-wise unaligned read
+static inline uint32_t load_shifted(const uint32_t *row, int x) {
+    const uint32_t *w = row + (x >> 2);
+    int shift = (x & 3) * 8;
+    return shift ? (w[0] >> shift) | (w[1] << (32 - shift)) : w[0];
+}
+
+// |a - b| for four 7-bit lanes at once
+static inline uint32_t sad4(uint32_t a, uint32_t b) {
+    // Guard bit set in a keeps each lane's subtraction from borrowing into the next
+    uint32_t diff = ((a | 0x80808080u) - b) ^ 0x80808080u;     // Per-lane a - b, two's complement
+    uint32_t neg = (diff & 0x80808080u) >> 7;                   // 1 in each negative lane
+    return (diff ^ (neg * 0xFF)) + neg;                         // Negate those lanes
+}
+
+static uint32_t block_sad(const uint32_t *cur, int cx, int cy, const uint32_t *prev, int px, int py) {
+    uint32_t acc = 0;   // Two 16-bit lane sums, at most 16 * 254 each
+
+    for(int r = 0; r < VO_BLOCK; r++) {
+        const uint32_t *c = cur + (cy + r) * STRIDE_WORDS + (cx >> 2);
+        const uint32_t *p = prev + (py + r) * STRIDE_WORDS;
+
+        uint32_t d0 = sad4(c[0], load_shifted(p, px));
+        uint32_t d1 = sad4(c[1], load_shifted(p, px + 4));
+        acc += (d0 & 0x00FF00FF) + ((d0 >> 8) & 0x00FF00FF);
+        acc += (d1 & 0x00FF00FF) + ((d1 >> 8) & 0x00FF00FF);
+    }
+    return (acc & 0xFFFF) + (acc >> 16);
+}
+
+// Returns -1 for a flat block, 0 for an ambiguous match, 1 with vec filled in
+static int match_block(const visual_odometry_t *vo, int bx, int by, block_vector_t *vec) {
+    const uint32_t *cur = vo->luma[vo->current];
+    const uint32_t *prev = vo->luma[vo->current ^ 1];
+    const int radius = vo->config.search_radius;
+    const int size = 2 * radius + 1;
+
+    if(block_sad(cur, bx, by, cur, bx + 1, by) < (uint32_t)vo->config.min_texture) {
+        return -1;
+    }
+
+    uint32_t sad[2 * VO_MAX_RADIUS + 1][2 * VO_MAX_RADIUS + 1];
+    int best_x = 0, best_y = 0;
+    uint32_t best = UINT32_MAX;
+
+    for(int dy = 0; dy < size; dy++) {
+        for(int dx = 0; dx < size; dx++) {
+            sad[dy][dx] = block_sad(cur, bx, by, prev, bx + dx - radius, by + dy - radius);
+            if(sad[dy][dx] < best) {
+                best = sad[dy][dx];
+                best_x = dx;
+                best_y = dy;
+            }
+        }
+    }
+
+    // Reject motion beyond the search window and repetitive texture
+    if(best_x == 0 || best_y == 0 || best_x == size - 1 || best_y == size - 1) {
+        return 0;
+    }
+    uint32_t second = UINT32_MAX;
+    for(int dy = 0; dy < size; dy++) {
+        for(int dx = 0; dx < size; dx++) {
+            if(abs(dx - best_x) <= 1 && abs(dy - best_y) <= 1) continue;
+            if(sad[dy][dx] < second) second = sad[dy][dx];
+        }
+    }
+    if(second < best + best / 8 + 16) {
+        return 0;
+    }
+
+    // Sub-pixel refinement: parabola through the minimum and its neighbors
+    float sub_x = 0, sub_y = 0;
+    int curv_x = sad[best_y][best_x - 1] + sad[best_y][best_x + 1] - 2 * (int)best;
+    int curv_y = sad[best_y - 1][best_x] + sad[best_y + 1][best_x] - 2 * (int)best;
+    if(curv_x > 0) sub_x = 0.5f * ((int)sad[best_y][best_x - 1] - (int)sad[best_y][best_x + 1]) / curv_x;
+    if(curv_y > 0) sub_y = 0.5f * ((int)sad[best_y - 1][best_x] - (int)sad[best_y + 1][best_x]) / curv_y;
+
+    // The block's content sat at (bx + offset) in the previous frame, so it moved by -offset
+    vec->rx = bx + VO_BLOCK / 2.0f - VO_W / 2.0f;
+    vec->ry = by + VO_BLOCK / 2.0f - VO_H / 2.0f;
+    vec->vx = -(best_x - radius + sub_x);
+    vec->vy = -(best_y - radius + sub_y);
+    return 1;
+}
+
+// Least squares for v = t + s * r + w * perp(r) on the selected vectors.
+// With block positions centered on their mean, s and w decouple from t.
+static void fit_motion(const block_vector_t *vecs, const uint8_t *use, int n, vo_motion_t *motion) {
+    float mean_rx = 0, mean_ry = 0, mean_vx = 0, mean_vy = 0;
+    int count = 0;
+
+    for(int i = 0; i < n; i++) {
+        if(!use[i]) continue;
+        mean_rx += vecs[i].rx;
+        mean_ry += vecs[i].ry;
+        mean_vx += vecs[i].vx;
+        mean_vy += vecs[i].vy;
+        count++;
+    }
+    mean_rx /= count;
+    mean_ry /= count;
+    mean_vx /= count;
+    mean_vy /= count;
+
+    float norm = 0, dot = 0, cross = 0;
+    for(int i = 0; i < n; i++) {
+        if(!use[i]) continue;
+        float rx = vecs[i].rx - mean_rx;
+        float ry = vecs[i].ry - mean_ry;
+        float vx = vecs[i].vx - mean_vx;
+        float vy = vecs[i].vy - mean_vy;
+        norm += rx * rx + ry * ry;
+        dot += rx * vx + ry * vy;
+        cross += rx * vy - ry * vx;
+    }
+
+    motion->scale = norm > 0 ? dot / norm : 0;
+    motion->rotation_rad = norm > 0 ? cross / norm : 0;
+
+    // Translation at the image center
+    motion->dx = mean_vx - motion->scale * mean_rx + motion->rotation_rad * mean_ry;
+    motion->dy = mean_vy - motion->scale * mean_ry - motion->rotation_rad * mean_rx;
+}
@@ -10,7 +10,11 @@
 #include "esp_log.h"
 #include "string.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_camera.h" // For camera_fb_t definition
+#include "param_store.h"
+#include "color_stream.h" // For mask_span_t
+#include "trace.h"
 #include <stdint.h> // Need this for uint16_t
 
 // Start Wi-Fi and the Web Server
@@ -19,6 +23,13 @@ void web_streamer_init(const char* ssid, const char* password);
 // Call this in your loop to push a frame to the browser
 void web_streamer_update_frame(camera_fb_t *fb);
 
+// Largest mask the /mask endpoint will forward, in spans (at most 0x7FFF)
+#define WEB_STREAMER_MAX_SPANS 1024
+
+// Call this in your loop to publish the tracker's match mask on /mask.
+// overflow marks a mask that was cut off for lack of spans; the page shows it.
+void web_streamer_update_mask(const mask_span_t *spans, uint32_t count, int overflow, int width, int height);
+
 // --- UPDATED FUNCTION ---
 // Now accepts cx and cy to draw a crosshair at the center
 void web_streamer_draw_overlay(camera_fb_t *fb, int x, int y, int w, int h, int cx, int cy, uint16_t box_color, uint16_t center_color);
@@ -7,8 +7,49 @@ static uint8_t *shared_frame_buf = NULL;
 static size_t shared_frame_len = 0;
 static int shared_width = 0;
 static int shared_height = 0;
+static pixformat_t shared_format = PIXFORMAT_RGB565;   // RGB565, or GRAYSCALE for YUV422 frames
+static uint32_t frame_seq = 0;                          // Bumped for every published frame
 static portMUX_TYPE frame_lock = portMUX_INITIALIZER_UNLOCKED; 
 
+// Filled by web_streamer_update_frame() outside the lock, then swapped with
+// shared_frame_buf. Only the producer touches it. The stream handler owns a
+// third buffer the same way, so neither the copy nor the JPEG encode runs
+// under the lock.
+static uint8_t *back_frame_buf = NULL;
+static size_t back_frame_len = 0;
+
+// Traced so the timeline shows who spins on and who holds frame_lock
+static inline void frame_lock_take(void) {
+    trace_begin(TRACE_FRAME_LOCK_WAIT);
+    portENTER_CRITICAL(&frame_lock);
+    trace_end(TRACE_FRAME_LOCK_WAIT);
+    trace_begin(TRACE_FRAME_LOCK);
+}
+
+static inline void frame_lock_give(void) {
+    trace_end(TRACE_FRAME_LOCK);
+    portEXIT_CRITICAL(&frame_lock);
+}
+
+#define STREAM_PERIOD_MS 80
+
+// Page and tuning API on CONTROL_PORT, the two endless streams on their own ports
+#define CONTROL_PORT 80
+#define STREAM_PORT 81
+#define MASK_PORT 82
+
+// --- MASK SPANS (guarded by frame_lock) ---
+static mask_span_t shared_spans[WEB_STREAMER_MAX_SPANS];
+static uint32_t shared_span_count = 0;
+static uint8_t mask_overflow = 0;
+static uint16_t mask_width = 0;
+static uint16_t mask_height = 0;
+static uint32_t mask_seq = 0;
+
+#define MASK_MAGIC 0x4B4D   // "MK", little-endian
+#define MASK_OVERFLOW 0x8000    // Set in the span count when the mask is cut off
+#define MASK_POLL_MS 10
+
 // --- HTML PAGE (Makes image larger) ---
 static const char* INDEX_HTML = 
 "<html><head>"
@@ -16,11 +57,40 @@ static const char* INDEX_HTML =
 "body { background-color: #111; display: flex; flex-direction: column; align-items: center; justify-content: center; color: white; font-family: sans-serif; height: 100vh; margin: 0; }"
 "h2 { margin-bottom: 10px; }"
 // CSS to scale the image up to 640x480 and keep edges sharp
-"img { width: 640px; height: 480px; image-rendering: pixelated; border: 3px solid #333; border-radius: 4px; }"
+"img, canvas { width: 640px; height: 480px; image-rendering: pixelated; border: 3px solid #333; border-radius: 4px; }"
+"#views { display: flex; gap: 10px; } canvas { background: #000; }"
+"#params { margin-top: 10px; } #params input { width: 70px; margin: 0 12px 0 4px; }"
 "</style>"
 "</head><body>"
 "<h2>RoboCar Vision</h2>"
-"<img src='/stream'>" // Points to the raw stream handler below
+"<div id='views'>"
+"<img id='stream'>" // Points to the raw stream handler below (STREAM_PORT)
+"<canvas id='mask' width='320' height='240'></canvas>"
+"</div>"
+"<div id='params'></div>"
+"<script>"
+"const host='http://'+location.hostname;"
+"document.getElementById('stream').src=host+':81/stream';"
+// Tuning panel: one input per parameter, applied on change
+"fetch('/params').then(r=>r.json()).then(ps=>{const d=document.getElementById('params');"
+"ps.forEach(p=>{const l=document.createElement('label');l.textContent=p.name;"
+"const i=document.createElement('input');i.type='number';i.step='any';i.min=p.min;i.max=p.max;i.value=p.value;"
+"i.onchange=()=>fetch('/params/set?name='+p.name+'&value='+i.value).then(r=>{i.style.color=r.ok?'':'red';});"
+"l.appendChild(i);d.appendChild(l);});});"
+// Mask decoder: frames of [magic, width, height, count] + count * [y, x, len], all uint16 LE.
+// The top bit of count flags a mask that ran out of spans.
+"(async()=>{const c=document.getElementById('mask'),g=c.getContext('2d');"
+"const r=(await fetch(host+':82/mask')).body.getReader();let b=new Uint8Array(0);"
+"for(;;){const{value,done}=await r.read();if(done)break;"
+"const n=new Uint8Array(b.length+value.length);n.set(b);n.set(value,b.length);b=n;"
+"while(b.length>=8){const d=new DataView(b.buffer,b.byteOffset,b.length);"
+"if(d.getUint16(0,true)!=0x4B4D){b=b.slice(1);continue;}"
+"const w=d.getUint16(2,true),h=d.getUint16(4,true),k=d.getUint16(6,true)&0x7FFF,len=8+k*6;if(b.length<len)break;"
+"c.width=w;c.height=h;g.fillStyle='#000';g.fillRect(0,0,w,h);g.fillStyle='#0f0';"
+"for(let i=0;i<k;i++){const o=8+i*6;g.fillRect(d.getUint16(o+2,true),d.getUint16(o,true),d.getUint16(o+4,true),1);}"
+"if(d.getUint16(6,true)&0x8000){g.fillStyle='#f00';g.fillText('MASK TRUNCATED',4,12);}"
+"b=b.slice(len);}}})();"
+"</script>"
 "</body></html>";
 
 // --- WIFI EVENT HANDLER ---
@@ -46,6 +116,103 @@ static esp_err_t index_handler(httpd_req_t *req) {
     return httpd_resp_send(req, INDEX_HTML, HTTPD_RESP_USE_STRLEN);
 }
 
+// --- PARAMETER HANDLERS ---
+static esp_err_t params_write_chunk(void *ctx, const char *text) {
+    return httpd_resp_sendstr_chunk((httpd_req_t *)ctx, text);
+}
+
+static esp_err_t params_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "application/json");
+
+    // Streamed, so the list can grow without a buffer to outgrow. On an error
+    // the connection is dropped rather than ending a truncated array cleanly.
+    esp_err_t err = param_store_to_json(params_write_chunk, req);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Parameter list failed (0x%x)", err);
+        return err;
+    }
+    return httpd_resp_sendstr_chunk(req, NULL);
+}
+
+static esp_err_t params_set_handler(httpd_req_t *req) {
+    char query[64];
+    char name[24];
+    char value[24];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "name", name, sizeof(name)) != ESP_OK ||
+        httpd_query_key_value(query, "value", value, sizeof(value)) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected ?name=...&value=...");
+    }
+
+    esp_err_t err = param_store_set(name, value);
+    if (err == ESP_ERR_NOT_FOUND) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown parameter");
+    } else if (err != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid value");
+    }
+    return httpd_resp_sendstr(req, "OK");
+}
+
+// --- TRACE HANDLER (Timeline dump, see host/trace2json.c) ---
+static esp_err_t trace_write_chunk(void *ctx, const void *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, (const char *)data, len);
+}
+
+static esp_err_t trace_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"robocar.trace\"");
+
+    esp_err_t err = trace_dump(trace_write_chunk, req);
+    if (err == ESP_ERR_INVALID_STATE || err == ESP_ERR_NOT_SUPPORTED) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Tracer not running");
+    }
+    if (err == ESP_ERR_TIMEOUT) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Tracer busy, try again");
+    }
+    if (err != ESP_OK) return err;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// --- MASK HANDLER (Run-length encoded match mask) ---
+static esp_err_t mask_handler(httpd_req_t *req) {
+    esp_err_t res = ESP_OK;
+    uint32_t last_seq = 0;
+
+    // Header plus spans, too large for the httpd task stack
+    size_t buf_size = 4 * sizeof(uint16_t) + sizeof(shared_spans);
+    uint8_t *buf = malloc(buf_size);
+    if (buf == NULL) return httpd_resp_send_500(req);
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    while (true) {
+        size_t len = 0;
+
+        frame_lock_take();
+        if (mask_seq != last_seq) {
+            uint16_t header[4] = { MASK_MAGIC, mask_width, mask_height,
+                                   shared_span_count | (mask_overflow ? MASK_OVERFLOW : 0) };
+            last_seq = mask_seq;
+            memcpy(buf, header, sizeof(header));
+            memcpy(buf + sizeof(header), shared_spans, shared_span_count * sizeof(mask_span_t));
+            len = sizeof(header) + shared_span_count * sizeof(mask_span_t);
+        }
+        frame_lock_give();
+
+        if (len > 0) {
+            trace_begin(TRACE_HTTP_SEND);
+            res = httpd_resp_send_chunk(req, (const char *)buf, len);
+            trace_end(TRACE_HTTP_SEND);
+            if (res != ESP_OK) break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(MASK_POLL_MS));
+    }
+    free(buf);
+    return res;
+}
+
 // --- STREAM HANDLER (Raw MJPEG Data) ---
 static esp_err_t stream_handler(httpd_req_t *req) {
     esp_err_t res = ESP_OK;
@@ -54,31 +221,66 @@ static esp_err_t stream_handler(httpd_req_t *req) {
     httpd_resp_set_type(req, "multipart/x-mixed-replace;boundary=123456789000000000000987654321");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
 
+    // Frame being encoded, swapped with shared_frame_buf when a newer one is published
+    uint8_t *frame_buf = NULL;
+    size_t frame_len = 0;
+    int width = 0;
+    int height = 0;
+    pixformat_t format = PIXFORMAT_RGB565;
+    uint32_t last_seq = 0;
+
+    // Pace frames from a fixed reference so the send time does not stretch the period
+    TickType_t last_wake = xTaskGetTickCount();
+
     while (true) {
         size_t jpg_buf_len = 0;
         uint8_t *jpg_buf = NULL;
 
-        portENTER_CRITICAL(&frame_lock);
-        if (shared_frame_buf == NULL) {
-            portEXIT_CRITICAL(&frame_lock);
-            vTaskDelay(pdMS_TO_TICKS(100));
+        robocar_params_t params;
+        param_store_snapshot(&params);
+
+        frame_lock_take();
+        const int fresh = frame_seq != last_seq;
+        if (fresh) {
+            uint8_t *old_buf = frame_buf;
+            size_t old_len = frame_len;
+            frame_buf = shared_frame_buf;
+            frame_len = shared_frame_len;
+            width = shared_width;
+            height = shared_height;
+            format = shared_format;
+            shared_frame_buf = old_buf;
+            shared_frame_len = old_len;
+            last_seq = frame_seq;
+        }
+        frame_lock_give();
+
+        // Nothing new to show: in the governor's slow modes a frame arrives
+        // only every few periods, so skip the encode and the Wi-Fi traffic
+        if (!fresh) {
+            vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(STREAM_PERIOD_MS));
             continue;
         }
-        
-        fmt2jpg(shared_frame_buf, shared_frame_len, shared_width, shared_height, PIXFORMAT_RGB565, 80, &jpg_buf, &jpg_buf_len);
-        portEXIT_CRITICAL(&frame_lock);
+
+        trace_begin(TRACE_JPEG_ENCODE);
+        fmt2jpg(frame_buf, frame_len, width, height, format, params.jpeg_quality, &jpg_buf, &jpg_buf_len);
+        trace_end(TRACE_JPEG_ENCODE);
 
         if (jpg_buf == NULL) continue;
 
         size_t hlen = snprintf(part_buf, 128, "\r\n--123456789000000000000987654321\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n", jpg_buf_len);
+        trace_begin(TRACE_HTTP_SEND);
         res = httpd_resp_send_chunk(req, (const char *)part_buf, hlen);
         if (res == ESP_OK) res = httpd_resp_send_chunk(req, (const char *)jpg_buf, jpg_buf_len);
+        trace_end(TRACE_HTTP_SEND);
         
         free(jpg_buf);
         if (res != ESP_OK) break;
 
-        vTaskDelay(pdMS_TO_TICKS(80));
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(STREAM_PERIOD_MS));
     }
+
+    free(frame_buf);
     return res;
 }
 
@@ -109,11 +311,13 @@ void web_streamer_init(const char* ssid, const char* password) {
     ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_handler, NULL, NULL));
     ESP_ERROR_CHECK(esp_wifi_start());
 
+    // Each httpd instance serves one request at a time, so the two endless
+    // streams get their own servers and never block the page or the tuning API.
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.server_port = 80;
-    httpd_handle_t stream_httpd = NULL;
+    config.server_port = CONTROL_PORT;
+    httpd_handle_t control_httpd = NULL;
 
-    if (httpd_start(&stream_httpd, &config) == ESP_OK) {
+    if (httpd_start(&control_httpd, &config) == ESP_OK) {
         // Register handler for root "/" URI to show HTML page
         httpd_uri_t index_uri = {
             .uri       = "/",
@@ -121,8 +325,40 @@ void web_streamer_init(const char* ssid, const char* password) {
             .handler   = index_handler,
             .user_ctx  = NULL
         };
-        httpd_register_uri_handler(stream_httpd, &index_uri);
+        httpd_register_uri_handler(control_httpd, &index_uri);
+
+        // Register handlers for live parameter tuning
+        httpd_uri_t params_uri = {
+            .uri       = "/params",
+            .method    = HTTP_GET,
+            .handler   = params_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(control_httpd, &params_uri);
 
+        httpd_uri_t params_set_uri = {
+            .uri       = "/params/set",
+            .method    = HTTP_GET,
+            .handler   = params_set_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(control_httpd, &params_set_uri);
+
+        // Register handler for the event timeline dump
+        httpd_uri_t trace_uri = {
+            .uri       = "/trace",
+            .method    = HTTP_GET,
+            .handler   = trace_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(control_httpd, &trace_uri);
+    }
+
+    config.server_port = STREAM_PORT;
+    config.ctrl_port += 1;
+    httpd_handle_t stream_httpd = NULL;
+
+    if (httpd_start(&stream_httpd, &config) == ESP_OK) {
         // Register handler for raw stream
         httpd_uri_t stream_uri = {
             .uri       = "/stream",
@@ -132,29 +368,100 @@ void web_streamer_init(const char* ssid, const char* password) {
         };
         httpd_register_uri_handler(stream_httpd, &stream_uri);
     }
+
+    config.server_port = MASK_PORT;
+    config.ctrl_port += 1;
+    httpd_handle_t mask_httpd = NULL;
+
+    if (httpd_start(&mask_httpd, &config) == ESP_OK) {
+        // Register handler for the run-length encoded match mask
+        httpd_uri_t mask_uri = {
+            .uri       = "/mask",
+            .method    = HTTP_GET,
+            .handler   = mask_handler,
+            .user_ctx  = NULL
+        };
+        httpd_register_uri_handler(mask_httpd, &mask_uri);
+    }
 }
 
 void web_streamer_update_frame(camera_fb_t *fb) {
     if(!fb) return;
     
-    portENTER_CRITICAL(&frame_lock);
-    if (shared_frame_buf == NULL || shared_frame_len != fb->len) {
-        if(shared_frame_buf) free(shared_frame_buf);
-        shared_frame_buf = malloc(fb->len);
-        shared_frame_len = fb->len;
-        shared_width = fb->width;
-        shared_height = fb->height;
+    // YUV422 frames stream their luma only: half the copy, and the encoder
+    // skips color conversion and chroma entirely
+    const int luma_only = fb->format == PIXFORMAT_YUV422;
+    const size_t len = luma_only ? fb->width * fb->height : fb->len;
+
+    trace_begin(TRACE_STREAM_COPY);
+    if (back_frame_buf == NULL || back_frame_len != len) {
+        free(back_frame_buf);
+        back_frame_buf = malloc(len);
+        back_frame_len = back_frame_buf ? len : 0;
     }
-    if (shared_frame_buf) {
-        memcpy(shared_frame_buf, fb->buf, fb->len);
+    if (back_frame_buf == NULL) {
+        trace_end(TRACE_STREAM_COPY);
+        return;
     }
-    portEXIT_CRITICAL(&frame_lock);
+    if (luma_only) {
+        for(size_t i = 0; i < len; i++) {
+            back_frame_buf[i] = fb->buf[i * 2];     // Y0 U Y1 V
+        }
+    } else {
+        memcpy(back_frame_buf, fb->buf, len);
+    }
+
+    // The stream handler only takes shared_frame_buf under the lock, so the
+    // buffer swapped out is free to refill next frame. It may come back
+    // NULL or with another size, then it is reallocated above.
+    uint8_t *front = back_frame_buf;
+    frame_lock_take();
+    back_frame_buf = shared_frame_buf;
+    back_frame_len = shared_frame_len;
+    shared_frame_buf = front;
+    shared_frame_len = len;
+    shared_width = fb->width;
+    shared_height = fb->height;
+    shared_format = luma_only ? PIXFORMAT_GRAYSCALE : PIXFORMAT_RGB565;
+    frame_seq++;
+    if (frame_seq == 0) frame_seq = 1;   // 0 means "nothing taken yet" to the handler
+    frame_lock_give();
+    trace_end(TRACE_STREAM_COPY);
 }
 
-// Helper to write a single pixel in RGB565
+void web_streamer_update_mask(const mask_span_t *spans, uint32_t count, int overflow, int width, int height) {
+    if(count > WEB_STREAMER_MAX_SPANS) {
+        count = WEB_STREAMER_MAX_SPANS;
+        overflow = 1;
+    }
+
+    trace_begin(TRACE_STREAM_COPY);
+    frame_lock_take();
+    memcpy(shared_spans, spans, count * sizeof(mask_span_t));
+    shared_span_count = count;
+    mask_overflow = overflow != 0;
+    mask_width = width;
+    mask_height = height;
+    mask_seq++;
+    if (mask_seq == 0) mask_seq = 1;   // 0 means "nothing sent yet" to the handler
+    frame_lock_give();
+    trace_end(TRACE_STREAM_COPY);
+}
+
+// Helper to write a single pixel in RGB565. In a YUV422 frame only the luma
+// byte is written, so the overlay shows as the color's brightness in the
+// grayscale stream and the shared chroma of the neighbor stays intact.
 static void set_pixel(camera_fb_t *fb, int x, int y, uint8_t hi, uint8_t lo) {
     if(x < 0 || x >= fb->width || y < 0 || y >= fb->height) return;
     int idx = (y * fb->width + x) * 2;
+    if(fb->format == PIXFORMAT_YUV422) {
+        uint16_t color = (hi << 8) | lo;
+        uint8_t r = (color & 0xF800) >> 8;
+        uint8_t g = (color & 0x07E0) >> 3;
+        uint8_t b = (color & 0x001F) << 3;
+        fb->buf[idx] = (77 * r + 150 * g + 29 * b) >> 8;
+        return;
+    }
     fb->buf[idx] = hi;
     fb->buf[idx+1] = lo;
 }
@@ -0,0 +1,351 @@
+/**
+ * Closed-loop host simulator.
+ *
+ * Renders synthetic RGB565 QVGA frames of a colored cylinder from the
+ * robot's pose, runs the real color tracker (color_stream.c), steering
+ * (navigator.c) and duty mapping (motor_duty.c) on them, and integrates
+ * differential-drive kinematics from the resulting 13-bit PWM duties. Every
+ * scenario in the table below runs faster than real time and reports tracking error, time to acquire, where
+ * and how fast the car stopped at the standoff, and the CPU cost of
+ * vision + control per simulated frame.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -Ihost/include -Icomponents/common/include -Icomponents/tools/include \
+ *       -Icomponents/navigator/include -Icomponents/motor_driver/include \
+ *       -Icomponents/param_store/include host/robocar_sim.c \
+ *       components/tools/color_stream.c components/navigator/navigator.c \
+ *       components/navigator/ttc_estimator.c components/motor_driver/motor_duty.c -lm -o robocar_sim
+ *
+ * Usage:
+ *   robocar_sim            Run every scenario
+ *   robocar_sim NAME       Run scenarios whose name contains NAME
+ *   robocar_sim -t NAME    Also print a per-frame trace
+ *
+ * Exits non-zero if any scenario does not meet its expectation.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "color_stream.h"
+#include "navigator.h"
+#include "motor_duty.h"
+#include "param_store.h"
+
+// Camera (OV2640/OV3660 at QVGA)
+#define FRAME_W         320
+#define FRAME_H         240
+#define STRIP_LINES     8           // Same strip height as compute_blob()
+#define HFOV_DEG        60.0f
+#define CAM_HEIGHT_M    0.08f
+
+// Robot
+#define SIM_DT_S        0.1f        // CONTROL_PERIOD_MS
+#define WHEEL_BASE_M    0.15f
+#define WHEEL_VMAX_MS   0.9f        // Wheel speed at 100% duty
+#define MOTOR_DEADBAND  8.0f        // Percent duty below which the wheels stall
+#define MOTOR_TAU_S     0.08f       // First-order motor response
+
+// Metrics
+#define ACQUIRE_PX      20          // Centroid error that counts as "locked on"
+#define CONTACT_M       0.05f       // Gap to the target surface that counts as a collision
+#define STANDOFF_TOL_M  0.08f       // Allowed error of the final gap against the standoff
+#define SETTLED_MS      0.01f       // Wheel speed below which the car has stopped
+
+#define DEG2RAD(d) ((d) * (float)M_PI / 180.0f)
+#define RAD2DEG(r) ((r) * 180.0f / (float)M_PI)
+
+typedef struct {
+    const char *name;
+    float target_x, target_y;       // Target position (m), robot starts at origin facing +x
+    float target_vx, target_vy;     // Target velocity (m/s)
+    float target_radius, target_height;
+    uint8_t target_rgb[3];
+    const h_range_t *track;         // Color handed to the tracker
+    int distractor;                 // Add an orange cylinder next to the target
+    float light;                    // Global illumination gain
+    int noise;                      // Peak per-channel noise
+    float duration_s;
+    int expect_acquire;
+} scenario_t;
+
+static const scenario_t SCENARIOS[] = {
+    { "straight",        2.0f,  0.0f, 0, 0,     0.08f, 0.30f, {220, 30, 30}, &COLOR_RED,   0, 1.0f, 12, 12, 1 },
+    { "offset_right",    2.0f, -0.8f, 0, 0,     0.08f, 0.30f, {220, 30, 30}, &COLOR_RED,   0, 1.0f, 12, 12, 1 },
+    { "offset_left_dim", 2.0f,  0.8f, 0, 0,     0.08f, 0.30f, {220, 30, 30}, &COLOR_RED,   0, 0.6f, 12, 12, 1 },
+    { "bright_noisy",    2.5f,  0.4f, 0, 0,     0.08f, 0.30f, {220, 30, 30}, &COLOR_RED,   0, 1.2f, 40, 12, 1 },
+    { "moving_target",   2.5f,  0.0f, 0, 0.12f, 0.08f, 0.30f, {220, 30, 30}, &COLOR_RED,   0, 1.0f, 12, 15, 1 },
+    { "distractor",      2.0f, -0.3f, 0, 0,     0.08f, 0.30f, {220, 30, 30}, &COLOR_RED,   1, 1.0f, 12, 12, 1 },
+    { "green_target",    2.0f,  0.5f, 0, 0,     0.08f, 0.30f, {40, 200, 60}, &COLOR_GREEN, 0, 1.0f, 12, 12, 1 },
+    { "out_of_view",     1.0f,  1.5f, 0, 0,     0.08f, 0.30f, {220, 30, 30}, &COLOR_RED,   0, 1.0f, 12, 5,  0 },
+};
+#define SCENARIO_COUNT ((int)(sizeof(SCENARIOS) / sizeof(SCENARIOS[0])))
+
+// The firmware's parameter defaults, see default_gains()
+static const robocar_params_t PARAMS = ROBOCAR_PARAMS_DEFAULT();
+
+typedef struct {
+    float x, y, theta;      // Pose
+    float v_left, v_right;  // Actual wheel speeds (m/s)
+} robot_t;
+
+typedef struct {
+    float time_to_acquire;  // Seconds, negative if never
+    float mean_px_error;
+    float mean_bearing_deg;
+    float final_gap;
+    float standoff_gap;     // Gap at which the target is standoff_width wide
+    float arrive_speed;     // Forward speed (m/s) when the navigator reported arrival
+    int reached;            // Stopped at the standoff without touching the target
+    int frames;
+    int found_frames;
+    double vision_us;       // Per frame, tracker + navigator
+} result_t;
+
+static uint8_t frame[FRAME_W * FRAME_H * 2];
+static uint32_t rng_state;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int rng_noise(int peak) {
+    // xorshift32, deterministic across platforms
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return peak ? (int)(rng_state % (2 * peak + 1)) - peak : 0;
+}
+
+static uint8_t clamp_u8(float v) {
+    return v < 0 ? 0 : v > 255 ? 255 : (uint8_t)v;
+}
+
+static void put_pixel(int x, int y, float r, float g, float b) {
+    uint16_t px = ((clamp_u8(r) & 0xF8) << 8) | ((clamp_u8(g) & 0xFC) << 3) | (clamp_u8(b) >> 3);
+    frame[(y * FRAME_W + x) * 2] = px >> 8;
+    frame[(y * FRAME_W + x) * 2 + 1] = px & 0xFF;
+}
+
+// Project a vertical cylinder into the image; returns 0 if behind the camera
+static int project_cylinder(const robot_t *bot, float wx, float wy, float radius, float height,
+                            float *u_center, float *half_w, float *v_top, float *v_bottom) {
+    const float f = (FRAME_W / 2) / tanf(DEG2RAD(HFOV_DEG / 2));
+    float dx = wx - bot->x;
+    float dy = wy - bot->y;
+    float forward = dx * cosf(bot->theta) + dy * sinf(bot->theta);
+    float lateral = -dx * sinf(bot->theta) + dy * cosf(bot->theta);   // Positive to the left
+
+    if(forward < 0.05f) return 0;
+    *u_center = FRAME_W / 2 - f * lateral / forward;
+    *half_w = f * radius / forward;
+    *v_top = FRAME_H / 2 - f * (height - CAM_HEIGHT_M) / forward;
+    *v_bottom = FRAME_H / 2 + f * CAM_HEIGHT_M / forward;
+    return 1;
+}
+
+static void draw_cylinder(const robot_t *bot, const scenario_t *sc, float wx, float wy, const uint8_t rgb[3]) {
+    float uc, hw, vt, vb;
+    if(!project_cylinder(bot, wx, wy, sc->target_radius, sc->target_height, &uc, &hw, &vt, &vb)) return;
+
+    int x0 = (int)floorf(uc - hw), x1 = (int)ceilf(uc + hw);
+    int y0 = (int)floorf(vt), y1 = (int)ceilf(vb);
+    if(x0 < 0) x0 = 0;
+    if(y0 < 0) y0 = 0;
+    if(x1 > FRAME_W - 1) x1 = FRAME_W - 1;
+    if(y1 > FRAME_H - 1) y1 = FRAME_H - 1;
+
+    for(int y = y0; y <= y1; y++) {
+        for(int x = x0; x <= x1; x++) {
+            float du = (x - uc) / hw;
+            if(du * du > 1) continue;
+            // Lambertian falloff towards the silhouette edges
+            float shade = sc->light * (0.55f + 0.45f * sqrtf(1 - du * du));
+            put_pixel(x, y, rgb[0] * shade + rng_noise(sc->noise),
+                            rgb[1] * shade + rng_noise(sc->noise),
+                            rgb[2] * shade + rng_noise(sc->noise));
+        }
+    }
+}
+
+static void render(const robot_t *bot, const scenario_t *sc, float tx, float ty) {
+    // Wall above the horizon, floor below, with a left-to-right light gradient
+    for(int y = 0; y < FRAME_H; y++) {
+        float base = y < FRAME_H / 2 ? 150.0f : 95.0f;
+        for(int x = 0; x < FRAME_W; x++) {
+            float l = sc->light * (0.85f + 0.3f * x / FRAME_W);
+            int n = rng_noise(sc->noise);
+            put_pixel(x, y, base * l + n, base * l + n, base * 0.95f * l + n);
+        }
+    }
+
+    if(sc->distractor) {
+        static const uint8_t ORANGE[3] = { 230, 120, 20 };
+        draw_cylinder(bot, sc, tx + 0.4f, ty + 0.45f, ORANGE);
+    }
+    draw_cylinder(bot, sc, tx, ty, sc->target_rgb);
+}
+
+static float duty_to_wheel_speed(uint32_t duty) {
+    float percent = 100.0f * duty / MOTOR_DUTY_MAX;
+    if(percent < MOTOR_DEADBAND) return 0;
+    return WHEEL_VMAX_MS * percent / 100.0f;
+}
+
+// Mapped as control_job() does in blob mode
+static nav_gains_t default_gains(void) {
+    nav_gains_t gains = {
+        .base_speed = PARAMS.base_speed,
+        .kp = PARAMS.kp,
+        .kd_heading = PARAMS.kd_heading,
+        .center_x = PARAMS.center_x,
+        .standoff_width = PARAMS.standoff_width,
+        .ttc_slow_s = PARAMS.ttc_slow_s
+    };
+    return gains;
+}
+
+static void step_robot(robot_t *bot, uint32_t duty_left, uint32_t duty_right, float dt) {
+    const int substeps = 10;
+    const float h = dt / substeps;
+    float target_l = duty_to_wheel_speed(duty_left);
+    float target_r = duty_to_wheel_speed(duty_right);
+
+    for(int i = 0; i < substeps; i++) {
+        bot->v_left += (target_l - bot->v_left) * h / MOTOR_TAU_S;
+        bot->v_right += (target_r - bot->v_right) * h / MOTOR_TAU_S;
+
+        float v = (bot->v_left + bot->v_right) / 2;
+        float w = (bot->v_right - bot->v_left) / WHEEL_BASE_M;
+        bot->x += v * cosf(bot->theta) * h;
+        bot->y += v * sinf(bot->theta) * h;
+        bot->theta += w * h;
+    }
+}
+
+static result_t run_scenario(const scenario_t *sc, int trace) {
+    robot_t bot = { 0 };
+    navigator_t nav = { 0 };
+    uint32_t duty_left = 0, duty_right = 0;
+    result_t res = { .time_to_acquire = -1, .arrive_speed = -1 };
+    double px_error_sum = 0, bearing_sum = 0, vision_total = 0;
+    int locked_frames = 0;
+    const nav_gains_t gains = default_gains();
+
+    const float f_px = (FRAME_W / 2) / tanf(DEG2RAD(HFOV_DEG / 2));
+    res.standoff_gap = f_px * 2 * sc->target_radius / gains.standoff_width - sc->target_radius;
+
+    rng_state = 2463534242u;
+    color_stream_set_thresholds(PARAMS.min_s, PARAMS.min_v, PARAMS.min_area);
+
+    int max_frames = (int)(sc->duration_s / SIM_DT_S);
+    for(int f = 0; f < max_frames; f++) {
+        float t = f * SIM_DT_S;
+        float tx = sc->target_x + sc->target_vx * t;
+        float ty = sc->target_y + sc->target_vy * t;
+
+        float gap = hypotf(tx - bot.x, ty - bot.y) - sc->target_radius;
+        if(gap < CONTACT_M) break;
+        if(res.arrive_speed >= 0 && fabsf(bot.v_left) < SETTLED_MS && fabsf(bot.v_right) < SETTLED_MS) {
+            res.reached = fabsf(gap - res.standoff_gap) < STANDOFF_TOL_M;
+            break;
+        }
+
+        render(&bot, sc, tx, ty);
+
+        // Vision + control, timed exactly as they run on the car
+        double t0 = now_us();
+        color_stream_t stream;
+        color_blob_t blob;
+        color_stream_begin_frame(&stream, FRAME_W, FRAME_H, sc->track);
+        for(int y = 0; y < FRAME_H; y += STRIP_LINES) {
+            color_stream_push_rows(&stream, frame + y * FRAME_W * 2, STRIP_LINES);
+        }
+        int found = color_stream_end_frame(&stream, &blob) == ESP_OK;
+
+        nav_command_t cmd;
+        nav_frame_t info = { FRAME_W, FRAME_H, (int64_t)f * (int64_t)(SIM_DT_S * 1e6f), 0 };
+        nav_action_t action = navigator_update(&nav, found ? &blob : NULL, &info, &gains, &cmd);
+        if(action == NAV_DRIVE) {
+            duty_left = percent_to_duty(cmd.left);
+            duty_right = percent_to_duty(cmd.right);
+        } else if(action == NAV_STOP || action == NAV_ARRIVED) {
+            duty_left = duty_right = 0;
+        }
+        if(action == NAV_ARRIVED && res.arrive_speed < 0) {
+            res.arrive_speed = (bot.v_left + bot.v_right) / 2;
+        }
+        vision_total += now_us() - t0;
+
+        float bearing = atan2f(ty - bot.y, tx - bot.x) - bot.theta;
+        bearing = atan2f(sinf(bearing), cosf(bearing));
+        int px_error = found ? abs(blob.centroid.x - gains.center_x) : -1;
+
+        if(found) res.found_frames++;
+        if(res.time_to_acquire < 0 && found && px_error < ACQUIRE_PX) {
+            res.time_to_acquire = t;
+        }
+        if(res.time_to_acquire >= 0) {
+            px_error_sum += found ? px_error : FRAME_W / 2;
+            bearing_sum += fabsf(RAD2DEG(bearing));
+            locked_frames++;
+        }
+
+        if(trace) {
+            printf("  t=%5.1f pose=(%5.2f,%5.2f,%6.1f) bearing=%6.1f found=%d cx=%4d area=%6u ttc=%5.1f gap=%4.2f duty=%4u/%4u\n",
+                   t, bot.x, bot.y, RAD2DEG(bot.theta), RAD2DEG(bearing), found,
+                   found ? blob.centroid.x : -1, found ? (unsigned)blob.area : 0,
+                   ttc_seconds(&nav.ttc), gap, (unsigned)duty_left, (unsigned)duty_right);
+        }
+
+        step_robot(&bot, duty_left, duty_right, SIM_DT_S);
+        res.frames++;
+    }
+
+    res.final_gap = hypotf(sc->target_x + sc->target_vx * res.frames * SIM_DT_S - bot.x,
+                           sc->target_y + sc->target_vy * res.frames * SIM_DT_S - bot.y) - sc->target_radius;
+    res.mean_px_error = locked_frames ? px_error_sum / locked_frames : -1;
+    res.mean_bearing_deg = locked_frames ? bearing_sum / locked_frames : -1;
+    res.vision_us = res.frames ? vision_total / res.frames : 0;
+    return res;
+}
+
+int main(int argc, char **argv) {
+    int trace = 0;
+    const char *filter = NULL;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-t") == 0) trace = 1;
+        else filter = argv[i];
+    }
+
+    int failures = 0;
+    double wall_start = now_us();
+    float sim_seconds = 0;
+
+    printf("%-16s %6s %8s %9s %9s %7s %7s %7s %10s  %s\n", "scenario", "frames", "acquire", "px_err",
+           "bearing", "gap_m", "v_stop", "found", "us/frame", "result");
+
+    for(int i = 0; i < SCENARIO_COUNT; i++) {
+        const scenario_t *sc = &SCENARIOS[i];
+        if(filter && strstr(sc->name, filter) == NULL) continue;
+
+        result_t r = run_scenario(sc, trace);
+        sim_seconds += r.frames * SIM_DT_S;
+
+        int acquired = r.time_to_acquire >= 0;
+        int ok = sc->expect_acquire ? (acquired && r.reached) : !acquired;
+        if(!ok) failures++;
+
+        printf("%-16s %6d %7.1fs %9.1f %8.1fd %7.2f %7.2f %6d%% %10.1f  %s\n", sc->name, r.frames,
+               r.time_to_acquire, r.mean_px_error, r.mean_bearing_deg, r.final_gap, r.arrive_speed,
+               r.frames ? 100 * r.found_frames / r.frames : 0, r.vision_us, ok ? "ok" : "FAIL");
+    }
+
+    double wall_s = (now_us() - wall_start) / 1e6;
+    printf("Simulated %.1f s in %.2f s (%.0fx real time)\n", sim_seconds, wall_s,
+           wall_s > 0 ? sim_seconds / wall_s : 0);
+    return failures ? 1 : 0;
+}
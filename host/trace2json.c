@@ -0,0 +1,232 @@
+/**
+ * Converts an event tracer dump (GET /trace) into Chrome trace JSON.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -Ihost/include -Icomponents/common/include host/trace2json.c -o trace2json
+ *
+ * Usage:
+ *   curl -o robocar.trace http://<robot ip>/trace
+ *   trace2json robocar.trace > robocar.json
+ *
+ * Open the JSON in ui.perfetto.dev or chrome://tracing. Each task gets a
+ * track with its pipeline stages as nested slices. When the firmware is
+ * built with ROBOCAR_TRACE_CONTEXT_SWITCHES, each CPU also gets a track
+ * showing which task it was running, which makes cross-core interference
+ * and priority inversion around frame_lock directly visible.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+#define UNNAMED_TASK TRACE_MAX_TASKS
+
+typedef struct {
+    int64_t time_us;        // Relative to the earliest event
+    int core;
+    uint32_t order;         // Keeps events with equal timestamps in dump order
+    trace_record_t rec;
+} event_t;
+
+static char event_names[TRACE_EVENT_MAX][TRACE_TASK_NAME_LEN + 1];
+static char task_names[TRACE_MAX_TASKS + 1][TRACE_TASK_NAME_LEN + 1];
+static int depth[TRACE_MAX_TASKS + 1][TRACE_EVENT_MAX];
+static int first_output = 1;
+
+static void begin_event(void) {
+    printf(first_output ? "\n  " : ",\n  ");
+    first_output = 0;
+}
+
+// Names come from the firmware's fixed tables, only quotes and backslashes need escaping
+static void print_string(const char *s) {
+    putchar('"');
+    for(; *s; s++) {
+        if(*s == '"' || *s == '\\') putchar('\\');
+        putchar(*s >= ' ' ? *s : '?');
+    }
+    putchar('"');
+}
+
+static const char *task_name(uint32_t index) {
+    return task_names[index < UNNAMED_TASK ? index : UNNAMED_TASK];
+}
+
+static int compare_events(const void *a, const void *b) {
+    const event_t *ea = a, *eb = b;
+    if(ea->time_us != eb->time_us) return ea->time_us < eb->time_us ? -1 : 1;
+    return ea->order < eb->order ? -1 : 1;
+}
+
+static void print_thread_name(int pid, int tid, const char *name) {
+    begin_event();
+    printf("{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", pid, tid);
+    print_string(name);
+    printf("}}");
+}
+
+static void print_slice(const char *ph, const char *name, int pid, int tid, int64_t ts, int core) {
+    begin_event();
+    printf("{\"ph\":\"%s\",\"name\":", ph);
+    print_string(name);
+    printf(",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"args\":{\"core\":%d}}", pid, tid, (long long)ts, core);
+}
+
+int main(int argc, char **argv) {
+    if(argc != 2) {
+        fprintf(stderr, "Usage: %s DUMP > trace.json\n", argv[0]);
+        return 2;
+    }
+
+    FILE *f = fopen(argv[1], "rb");
+    if(f == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    trace_dump_header_t header;
+    if(fread(&header, sizeof(header), 1, f) != 1 || header.magic != TRACE_DUMP_MAGIC ||
+       header.version != TRACE_DUMP_VERSION || header.cores > TRACE_CORES ||
+       header.event_count > TRACE_EVENT_MAX || header.task_count > TRACE_MAX_TASKS) {
+        fprintf(stderr, "%s: not a version %d trace dump\n", argv[1], TRACE_DUMP_VERSION);
+        return 1;
+    }
+
+    for(int i = 0; i < TRACE_EVENT_MAX; i++) {
+        snprintf(event_names[i], sizeof(event_names[i]), "event %d", i);
+    }
+    for(int i = 0; i <= TRACE_MAX_TASKS; i++) {
+        snprintf(task_names[i], sizeof(task_names[i]), i < TRACE_MAX_TASKS ? "task %d" : "unnamed", i);
+    }
+    for(int i = 0; i < header.event_count; i++) {
+        if(fread(event_names[i], TRACE_TASK_NAME_LEN, 1, f) != 1) goto truncated;
+    }
+    for(int i = 0; i < header.task_count; i++) {
+        if(fread(task_names[i], TRACE_TASK_NAME_LEN, 1, f) != 1) goto truncated;
+    }
+
+    event_t *events = NULL;
+    uint32_t total = 0;
+    for(int core = 0; core < header.cores; core++) {
+        uint32_t count;
+        if(fread(&count, sizeof(count), 1, f) != 1 || count > TRACE_RING_EVENTS) goto truncated;
+        if(count == 0) continue;
+
+        events = realloc(events, (total + count) * sizeof(event_t));
+        if(events == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        for(uint32_t i = 0; i < count; i++) {
+            event_t *e = &events[total + i];
+            if(fread(&e->rec, sizeof(e->rec), 1, f) != 1) goto truncated;
+            e->core = core;
+            e->order = total + i;
+        }
+        total += count;
+    }
+    fclose(f);
+
+    // Timestamps are the low 32 bits of a microsecond clock: unwrap them
+    // relative to the first event, then shift so the earliest one is at 0
+    int64_t earliest = 0;
+    for(uint32_t i = 0; i < total; i++) {
+        events[i].time_us = (int32_t)(events[i].rec.time_us - events[0].rec.time_us);
+        if(events[i].time_us < earliest) earliest = events[i].time_us;
+    }
+    for(uint32_t i = 0; i < total; i++) {
+        events[i].time_us -= earliest;
+    }
+    qsort(events, total, sizeof(event_t), compare_events);
+
+    // pid 1: one track per task with its pipeline stages; pid 2: one track per CPU
+    printf("{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_core0\":%u,\"dropped_core1\":%u},\"traceEvents\":[",
+           (unsigned)header.dropped[0], (unsigned)header.dropped[1]);
+    begin_event();
+    printf("{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"Tasks\"}}");
+    begin_event();
+    printf("{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":2,\"args\":{\"name\":\"CPUs\"}}");
+    uint8_t seen[TRACE_MAX_TASKS + 1] = { 0 };
+    for(uint32_t i = 0; i < total; i++) {
+        if(events[i].rec.phase != TRACE_INSTANT || events[i].rec.event == TRACE_TASK_SWITCH) {
+            seen[events[i].rec.arg < UNNAMED_TASK ? events[i].rec.arg : UNNAMED_TASK] = 1;
+        }
+    }
+    for(int i = 0; i <= TRACE_MAX_TASKS; i++) {
+        if(seen[i]) print_thread_name(1, i, task_names[i]);
+    }
+    for(int core = 0; core < header.cores; core++) {
+        char name[16];
+        snprintf(name, sizeof(name), "CPU %d", core);
+        print_thread_name(2, core, name);
+    }
+
+    int64_t running_since[TRACE_CORES];
+    int running[TRACE_CORES];
+    for(int core = 0; core < TRACE_CORES; core++) running[core] = -1;
+
+    uint32_t unmatched = 0;
+    int64_t last_time = total ? events[total - 1].time_us : 0;
+
+    for(uint32_t i = 0; i < total; i++) {
+        const event_t *e = &events[i];
+        uint32_t task = e->rec.arg < UNNAMED_TASK ? e->rec.arg : UNNAMED_TASK;
+        int event = e->rec.event < TRACE_EVENT_MAX ? e->rec.event : 0;
+
+        if(e->rec.phase == TRACE_BEGIN) {
+            depth[task][event]++;
+            print_slice("B", event_names[event], 1, task, e->time_us, e->core);
+        } else if(e->rec.phase == TRACE_END) {
+            // The matching begin may have been overwritten before the dump
+            if(depth[task][event] == 0) {
+                unmatched++;
+                continue;
+            }
+            depth[task][event]--;
+            print_slice("E", event_names[event], 1, task, e->time_us, e->core);
+        } else if(event == TRACE_TASK_SWITCH) {
+            if(running[e->core] >= 0) {
+                begin_event();
+                printf("{\"ph\":\"X\",\"name\":");
+                print_string(task_name(running[e->core]));
+                printf(",\"pid\":2,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}", e->core,
+                       (long long)running_since[e->core], (long long)(e->time_us - running_since[e->core]));
+            }
+            running[e->core] = task;
+            running_since[e->core] = e->time_us;
+        } else {
+            begin_event();
+            printf("{\"ph\":\"i\",\"s\":\"t\",\"name\":");
+            print_string(event_names[event]);
+            printf(",\"pid\":2,\"tid\":%d,\"ts\":%lld,\"args\":{\"arg\":%u}}", e->core,
+                   (long long)e->time_us, (unsigned)e->rec.arg);
+        }
+    }
+
+    // Close whatever was still open when the dump was taken
+    for(int task = 0; task <= TRACE_MAX_TASKS; task++) {
+        for(int event = 0; event < TRACE_EVENT_MAX; event++) {
+            while(depth[task][event]-- > 0) {
+                print_slice("E", event_names[event], 1, task, last_time, -1);
+            }
+        }
+    }
+    for(int core = 0; core < header.cores; core++) {
+        if(running[core] < 0) continue;
+        begin_event();
+        printf("{\"ph\":\"X\",\"name\":");
+        print_string(task_name(running[core]));
+        printf(",\"pid\":2,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}", core,
+               (long long)running_since[core], (long long)(last_time - running_since[core]));
+    }
+    printf("\n]}\n");
+
+    fprintf(stderr, "%u events, %u ends without a begin, %u + %u overwritten on the robot\n",
+            (unsigned)total, (unsigned)unmatched, (unsigned)header.dropped[0], (unsigned)header.dropped[1]);
+    free(events);
+    return 0;
+
+truncated:
+    fprintf(stderr, "%s: truncated dump\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,350 @@
+/**
+ * Host benchmark for the streaming color tracker.
+ *
+ * Builds synthetic QVGA RGB565 frames and feeds them through
+ * color_stream_begin_frame / push_rows / end_frame in strips of different
+ * heights, checking that every strip height gives the same blob and that
+ * the run-length mask covers exactly the matched pixels. Converts the same
+ * frames to YUV422 and checks the native U/V classifier finds the same
+ * blobs as the HSV path, and how much faster. Also times the scanline line
+ * follower against the full-frame tracker on a tape frame, checks it fits
+ * the same line in YUV422, and runs visual odometry on synthetic (or
+ * recorded) frame pairs in both formats.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -Ihost/include -Icomponents/common/include -Icomponents/tools/include \
+ *       host/vision_bench.c components/tools/color_stream.c \
+ *       components/tools/line_follower.c components/tools/visual_odometry.c -lm -o vision_bench
+ *
+ * Usage:
+ *   vision_bench                   Synthetic frames only
+ *   vision_bench PREV CUR          Also run visual odometry on a recorded pair
+ *                                  (raw big-endian RGB565 QVGA, 153600 bytes each)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "color_stream.h"
+#include "line_follower.h"
+#include "visual_odometry.h"
+
+#define FRAME_W 320
+#define FRAME_H 240
+#define BENCH_FRAMES 50
+#define STRIP_LINES_BENCH 8     // Strip height used by the firmware
+
+static uint8_t frame[FRAME_W * FRAME_H * 2];
+static uint8_t frame_prev[FRAME_W * FRAME_H * 2];
+static uint8_t frame_yuv[FRAME_W * FRAME_H * 2];
+static visual_odometry_t vo;
+static mask_span_t spans[1024];
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void put_rgb565(uint8_t *buf, int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+    uint16_t px = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    buf[(y * FRAME_W + x) * 2] = px >> 8;
+    buf[(y * FRAME_W + x) * 2 + 1] = px & 0xFF;
+}
+
+// Gray noisy floor with a red disc of radius r centered at (cx, cy)
+static void render_disc(uint8_t *buf, int cx, int cy, int r, unsigned seed) {
+    srand(seed);
+    for(int y = 0; y < FRAME_H; y++) {
+        for(int x = 0; x < FRAME_W; x++) {
+            int n = rand() % 24;
+            int dx = x - cx;
+            int dy = y - cy;
+            if(dx * dx + dy * dy <= r * r) {
+                put_rgb565(buf, x, y, 200 + n, 20 + n, 20 + n);
+            } else {
+                put_rgb565(buf, x, y, 110 + n, 110 + n, 100 + n);
+            }
+        }
+    }
+}
+
+// Gray noisy floor with a blue tape band whose center is x0 at the bottom row
+// and moves by slope pixels per row going up
+static void render_tape(uint8_t *buf, float x0, float slope, int half_width, unsigned seed) {
+    srand(seed);
+    for(int y = 0; y < FRAME_H; y++) {
+        float center = x0 + slope * (FRAME_H - 1 - y);
+        for(int x = 0; x < FRAME_W; x++) {
+            int n = rand() % 24;
+            if(x >= center - half_width && x <= center + half_width) {
+                put_rgb565(buf, x, y, 20 + n, 40 + n, 190 + n);
+            } else {
+                put_rgb565(buf, x, y, 110 + n, 110 + n, 100 + n);
+            }
+        }
+    }
+}
+
+// Smooth value-noise texture sampled at (u, v), cells of 12 pixels
+static float texture(float u, float v) {
+    const int cell = 12;
+    int cx = (int)floorf(u / cell), cy = (int)floorf(v / cell);
+    float fx = u / cell - cx, fy = v / cell - cy;
+    float corner[4];
+    for(int i = 0; i < 4; i++) {
+        uint32_t h = (uint32_t)(cx + (i & 1)) * 73856093u ^ (uint32_t)(cy + (i >> 1)) * 19349663u;
+        h ^= h >> 13;
+        h *= 0x5bd1e995u;
+        corner[i] = (h >> 24) & 0xFF;
+    }
+    float top = corner[0] + (corner[1] - corner[0]) * fx;
+    float bottom = corner[2] + (corner[3] - corner[2]) * fx;
+    return top + (bottom - top) * fy;
+}
+
+// Texture moved by (shift_x, shift_y), scaled by zoom and rotated by rot_rad
+// (clockwise on screen, y pointing down) around the image center
+static void render_texture(uint8_t *buf, float shift_x, float shift_y, float zoom, float rot_rad) {
+    float c = cosf(rot_rad), s = sinf(rot_rad);
+    for(int y = 0; y < FRAME_H; y++) {
+        for(int x = 0; x < FRAME_W; x++) {
+            float sx = (x - FRAME_W / 2 - shift_x) / zoom;
+            float sy = (y - FRAME_H / 2 - shift_y) / zoom;
+            float u = c * sx + s * sy + FRAME_W / 2;
+            float v = -s * sx + c * sy + FRAME_H / 2;
+            uint8_t l = (uint8_t)texture(u, v);
+            put_rgb565(buf, x, y, l, l, l);
+        }
+    }
+}
+
+static int load_raw(const char *path, uint8_t *buf) {
+    FILE *f = fopen(path, "rb");
+    if(f == NULL) return 0;
+    size_t n = fread(buf, 1, FRAME_W * FRAME_H * 2, f);
+    fclose(f);
+    return n == FRAME_W * FRAME_H * 2;
+}
+
+// Run visual odometry on frame_prev -> frame, print and time the second frame
+static esp_err_t run_vo(const char *label, vo_motion_t *motion) {
+    const vo_config_t config = VO_CONFIG_DEFAULT();
+    esp_err_t res = ESP_OK;
+    double total = 0;
+
+    for(int f = 0; f < BENCH_FRAMES; f++) {
+        vo_init(&vo, &config);
+        vo_process_rgb565(&vo, frame_prev, FRAME_W, FRAME_H, motion);
+
+        double t0 = now_us();
+        res = vo_process_rgb565(&vo, frame, FRAME_W, FRAME_H, motion);
+        total += now_us() - t0;
+    }
+
+    printf("VO %-10s: dx %5.2f dy %5.2f scale %7.4f rot %7.4f conf %.2f blocks %d  %7.1f us/frame\n",
+           label, motion->dx, motion->dy, motion->scale, motion->rotation_rad,
+           motion->confidence, motion->blocks, total / BENCH_FRAMES);
+    return res;
+}
+
+static uint8_t clamp_u8(float x) {
+    return x < 0 ? 0 : x > 255 ? 255 : (uint8_t)(x + 0.5f);
+}
+
+// What the sensor would output for the same scene: full-range BT.601,
+// Y0 U Y1 V with the chroma of each pixel pair averaged
+static void rgb565_to_yuv422(const uint8_t *src, uint8_t *dst) {
+    for(int i = 0; i < FRAME_W * FRAME_H; i += 2) {
+        float y[2], u = 0, v = 0;
+        for(int k = 0; k < 2; k++) {
+            uint16_t px = (src[(i + k) * 2] << 8) | src[(i + k) * 2 + 1];
+            float r = (px & 0xF800) >> 8, g = (px & 0x07E0) >> 3, b = (px & 0x001F) << 3;
+            y[k] = 0.299f * r + 0.587f * g + 0.114f * b;
+            u += (-0.168736f * r - 0.331264f * g + 0.5f * b) / 2;
+            v += (0.5f * r - 0.418688f * g - 0.081312f * b) / 2;
+        }
+        dst[i * 2] = clamp_u8(y[0]);
+        dst[i * 2 + 1] = clamp_u8(u + 128);
+        dst[i * 2 + 2] = clamp_u8(y[1]);
+        dst[i * 2 + 3] = clamp_u8(v + 128);
+    }
+}
+
+static esp_err_t run_format(const uint8_t *buf, color_format_t format, const h_range_t *target,
+                            int strip_lines, color_blob_t *blob) {
+    color_stream_t stream;
+    color_stream_begin_frame(&stream, FRAME_W, FRAME_H, target);
+    color_stream_set_format(&stream, format);
+    for(int y = 0; y < FRAME_H; y += strip_lines) {
+        int n = FRAME_H - y < strip_lines ? FRAME_H - y : strip_lines;
+        color_stream_push_rows(&stream, buf + y * FRAME_W * 2, n);
+    }
+    return color_stream_end_frame(&stream, blob);
+}
+
+static esp_err_t run_strips(const uint8_t *buf, int strip_lines, color_blob_t *blob) {
+    return run_format(buf, COLOR_FORMAT_RGB565, &COLOR_RED, strip_lines, blob);
+}
+
+// Same blob within a pixel. A pixel pair straddling an edge shares one
+// chroma sample, so the area may differ by up to two pixels per row.
+static int blobs_agree(const color_blob_t *a, const color_blob_t *b) {
+    int rows = a->bottom_right.y - a->top_left.y + 1;
+    return abs(a->centroid.x - b->centroid.x) <= 1 && abs(a->centroid.y - b->centroid.y) <= 1 &&
+           abs(a->top_left.x - b->top_left.x) <= 1 && abs(a->top_left.y - b->top_left.y) <= 1 &&
+           abs(a->bottom_right.x - b->bottom_right.x) <= 1 && abs(a->bottom_right.y - b->bottom_right.y) <= 1 &&
+           abs((int)a->area - (int)b->area) <= 2 * rows;
+}
+
+// Time both formats on frame (RGB565) and its YUV422 conversion
+static int compare_yuv(const char *label, const h_range_t *target) {
+    color_blob_t rgb, yuv;
+    double us[2];
+
+    rgb565_to_yuv422(frame, frame_yuv);
+    for(int k = 0; k < 2; k++) {
+        double t0 = now_us();
+        for(int f = 0; f < BENCH_FRAMES; f++) {
+            if(k == 0) run_format(frame, COLOR_FORMAT_RGB565, target, STRIP_LINES_BENCH, &rgb);
+            else run_format(frame_yuv, COLOR_FORMAT_YUV422, target, STRIP_LINES_BENCH, &yuv);
+        }
+        us[k] = (now_us() - t0) / BENCH_FRAMES;
+    }
+
+    int ok = rgb.area > 0 && blobs_agree(&rgb, &yuv);
+    printf("YUV422 %-5s: centroid (%d, %d) area %u vs RGB565 (%d, %d) %u, %7.1f vs %7.1f us/frame %s\n",
+           label, yuv.centroid.x, yuv.centroid.y, (unsigned)yuv.area, rgb.centroid.x, rgb.centroid.y,
+           (unsigned)rgb.area, us[1], us[0], ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const int strips[] = { 1, 8, 16, FRAME_H };
+    const int n_strips = sizeof(strips) / sizeof(strips[0]);
+    int failures = 0;
+
+    render_disc(frame, 200, 90, 30, 1);
+
+    color_blob_t ref;
+    if(run_strips(frame, FRAME_H, &ref) != ESP_OK) {
+        printf("FAIL: target not found in synthetic frame\n");
+        return 1;
+    }
+    printf("Reference blob: centroid (%d, %d) box (%d, %d)-(%d, %d) area %u\n",
+           ref.centroid.x, ref.centroid.y, ref.top_left.x, ref.top_left.y,
+           ref.bottom_right.x, ref.bottom_right.y, (unsigned)ref.area);
+
+    // Run-length mask: every matched pixel in exactly one span
+    color_stream_t stream;
+    color_blob_t masked;
+    color_stream_begin_frame(&stream, FRAME_W, FRAME_H, &COLOR_RED);
+    color_stream_set_span_buffer(&stream, spans, sizeof(spans) / sizeof(spans[0]));
+    color_stream_push_rows(&stream, frame, FRAME_H);
+    color_stream_end_frame(&stream, &masked);
+
+    uint32_t covered = 0;
+    for(uint32_t i = 0; i < stream.span_count; i++) covered += spans[i].len;
+    int mask_ok = covered == ref.area && !stream.span_overflow;
+    if(!mask_ok) failures++;
+    printf("Mask: %u spans, %u bytes, %u pixels %s\n", (unsigned)stream.span_count,
+           (unsigned)(8 + stream.span_count * sizeof(mask_span_t)), (unsigned)covered,
+           mask_ok ? "ok" : "MISMATCH");
+
+    for(int i = 0; i < n_strips; i++) {
+        color_blob_t blob;
+        double t0 = now_us();
+        for(int f = 0; f < BENCH_FRAMES; f++) {
+            run_strips(frame, strips[i], &blob);
+        }
+        double per_frame = (now_us() - t0) / BENCH_FRAMES;
+
+        int same = memcmp(&blob, &ref, sizeof(blob)) == 0;
+        if(!same) failures++;
+        printf("strip %3d lines: %8.1f us/frame %s\n", strips[i], per_frame, same ? "ok" : "MISMATCH");
+    }
+
+    // Native YUV422 classification against the HSV path on the same scenes
+    if(!compare_yuv("disc", &COLOR_RED)) failures++;
+
+    // Line follower on a tape drifting right as it goes ahead
+    const line_follower_config_t line_config = LINE_FOLLOWER_CONFIG_DEFAULT();
+    render_tape(frame, 150.0f, 0.25f, 10, 2);
+    if(!compare_yuv("tape", &COLOR_BLUE)) failures++;
+
+    color_blob_t look;
+    line_fit_t fit;
+    double t0 = now_us();
+    for(int f = 0; f < BENCH_FRAMES; f++) {
+        line_follower_process(frame, FRAME_W, FRAME_H, COLOR_FORMAT_RGB565, &COLOR_BLUE, &line_config, &look, &fit);
+    }
+    double line_us = (now_us() - t0) / BENCH_FRAMES;
+
+    color_blob_t tape_blob;
+    t0 = now_us();
+    color_stream_t tape_stream;
+    color_stream_begin_frame(&tape_stream, FRAME_W, FRAME_H, &COLOR_BLUE);
+    color_stream_push_rows(&tape_stream, frame, FRAME_H);
+    color_stream_end_frame(&tape_stream, &tape_blob);
+    double full_us = now_us() - t0;
+
+    // Expected: offset -10 px at the bottom, heading atan(0.25) = 14 degrees
+    int line_ok = fit.valid_lines == line_config.scanlines &&
+                  fabsf(fit.offset_px + 10.0f) < 2.0f && fabsf(fit.heading_rad - 0.245f) < 0.02f;
+    if(!line_ok) failures++;
+    printf("Line: offset %.1f px, heading %.1f deg, look-ahead (%d, %d), %d lines %s\n",
+           fit.offset_px, fit.heading_rad * 57.2958f, look.centroid.x, look.centroid.y,
+           fit.valid_lines, line_ok ? "ok" : "MISMATCH");
+    printf("Line follower: %8.1f us/frame vs full frame %8.1f us\n", line_us, full_us);
+
+    // Same tape in YUV422 (frame_yuv still holds it from compare_yuv)
+    color_blob_t look_yuv;
+    line_fit_t fit_yuv;
+    line_follower_process(frame_yuv, FRAME_W, FRAME_H, COLOR_FORMAT_YUV422, &COLOR_BLUE, &line_config, &look_yuv, &fit_yuv);
+    int line_yuv_ok = fit_yuv.valid_lines == fit.valid_lines &&
+                      fabsf(fit_yuv.offset_px - fit.offset_px) < 1.0f && fabsf(fit_yuv.heading_rad - fit.heading_rad) < 0.02f;
+    if(!line_yuv_ok) failures++;
+    printf("Line YUV422: offset %.1f px, heading %.1f deg, %d lines %s\n",
+           fit_yuv.offset_px, fit_yuv.heading_rad * 57.2958f, fit_yuv.valid_lines, line_yuv_ok ? "ok" : "MISMATCH");
+
+    // Visual odometry: 8 px right / 4 px up at QVGA is (2, -1) in luma pixels
+    vo_motion_t motion;
+    render_texture(frame_prev, 0, 0, 1.0f, 0);
+    render_texture(frame, 8.0f, -4.0f, 1.0f, 0);
+    run_vo("shift", &motion);
+    int vo_ok = fabsf(motion.dx - 2.0f) < 0.3f && fabsf(motion.dy + 1.0f) < 0.3f && motion.confidence > 0.5f;
+
+    render_texture(frame, 0, 0, 1.03f, 0);
+    run_vo("zoom 3%", &motion);
+    vo_ok = vo_ok && fabsf(motion.dx) < 0.3f && fabsf(motion.dy) < 0.3f && fabsf(motion.scale - 0.03f) < 0.01f;
+
+    render_texture(frame, 0, 0, 1.0f, 0.02f);
+    run_vo("rotate", &motion);
+    vo_ok = vo_ok && fabsf(motion.dx) < 0.3f && fabsf(motion.dy) < 0.3f && fabsf(motion.scale) < 0.005f &&
+            fabsf(motion.rotation_rad - 0.02f) < 0.005f;
+
+    // Same shift from the Y bytes of YUV422 frames
+    render_texture(frame_prev, 0, 0, 1.0f, 0);
+    render_texture(frame, 8.0f, -4.0f, 1.0f, 0);
+    rgb565_to_yuv422(frame_prev, frame_yuv);
+    vo_init(&vo, &(vo_config_t)VO_CONFIG_DEFAULT());
+    vo_process_yuv422(&vo, frame_yuv, FRAME_W, FRAME_H, &motion);
+    rgb565_to_yuv422(frame, frame_yuv);
+    vo_process_yuv422(&vo, frame_yuv, FRAME_W, FRAME_H, &motion);
+    printf("VO %-10s: dx %5.2f dy %5.2f conf %.2f\n", "yuv shift", motion.dx, motion.dy, motion.confidence);
+    vo_ok = vo_ok && fabsf(motion.dx - 2.0f) < 0.3f && fabsf(motion.dy + 1.0f) < 0.3f && motion.confidence > 0.5f;
+
+    if(!vo_ok) failures++;
+    printf("VO synthetic %s\n", vo_ok ? "ok" : "MISMATCH");
+
+    if(argc == 3) {
+        if(!load_raw(argv[1], frame_prev) || !load_raw(argv[2], frame)) {
+            printf("Could not read frame pair %s %s\n", argv[1], argv[2]);
+            return 1;
+        }
+        run_vo("recorded", &motion);
+    }
+
+    return failures ? 1 : 0;
+}
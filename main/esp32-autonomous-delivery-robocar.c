@@ -1,10 +1,18 @@
+#include <math.h>
 #include <stdio.h>
 #include "common_types.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "motor_driver.h"
 #include "camera.h"
+#include "camera_governor.h"
 #include "color_tracker.h"
+#include "line_follower.h"
+#include "visual_odometry.h"
+#include "rt_task.h"
+#include "trace.h"
+#include "param_store.h"
+#include "navigator.h"
 #include "esp_log.h"
 #include "secrets.h"
 
@@ -14,75 +22,264 @@
 // Settings
 #define WIFI_SSID SECRET_SSID
 #define WIFI_PASS SECRET_PASS
-#define BASE_SPEED 28.0f 
-#define KP 0.04f
-#define CENTER_X 160
+#define TARGET_COLOR COLOR_RED     // Blob followed in VISION_BLOB mode
+#define TAPE_COLOR COLOR_BLUE      // Floor tape followed in VISION_LINE mode
+
+// Stall detection: driving, but the camera sees (almost) no motion. Tuned at
+// CONTROL_PERIOD_MS and scaled to the period actually running.
+#define STALL_MAX_MOTION_PX 0.15f   // Luma pixels per frame, translation plus expansion at the edge
+#define STALL_MIN_CONFIDENCE 0.6f
+#define STALL_FRAMES 10
+#define STALL_HOLD_FRAMES 30        // Frames to stay stopped after a stall before driving again
+
+// Values of the vision_mode parameter
+#define VISION_BLOB 0
+#define VISION_LINE 1
+
+// Task timing (rate-monotonic: shorter period gets the higher priority)
+#define CONTROL_PERIOD_MS   100
+#define CONTROL_DEADLINE_MS 100
+#define LINE_PERIOD_MS      40  // Line mode samples a few scanlines only, so it keeps up with the sensor (~25 fps)
+#define CONTROL_PRIORITY    5
+#define CONTROL_CORE        1   // Wi-Fi and the HTTP server live on core 0
+#define MONITOR_PERIOD_MS   5000
+#define MONITOR_PRIORITY    1
+
+static const char *TAG = "MAIN";
+
+// RGB565 Color Definitions
+static const uint16_t BOX_COLOR    = 0x07E0; // Green
+static const uint16_t CENTER_COLOR = 0x001F; // Blue
+
+// Match mask of the last frame, forwarded to /mask
+static mask_span_t mask_spans[WEB_STREAMER_MAX_SPANS];
+
+// Tuning values, refreshed from the parameter store between frames only
+static robocar_params_t params;
+static uint32_t params_version = UINT32_MAX;
+
+static const line_follower_config_t line_config = LINE_FOLLOWER_CONFIG_DEFAULT();
+
+static visual_odometry_t odometry;
+static uint8_t stall_hold = 0;      // Frames left before the navigator may drive again
+
+static rt_task_t *control_rt = NULL;
+static uint32_t control_period_ms = CONTROL_PERIOD_MS;
+
+// 0 when nothing was found, 1 once the blob covers twice the minimum area
+static float detection_confidence(esp_err_t res, const color_blob_t *blob, const camera_fb_t *fb) {
+    if(res != ESP_OK) return 0;
+    if(params.vision_mode == VISION_LINE) return 1;
+
+    float min_area = (float)params.min_area * fb->width * fb->height / REF_FRAME_PIXELS;
+    float confidence = min_area > 0 ? blob->area / (2 * min_area) : 1;
+    return confidence < 1 ? confidence : 1;
+}
+
+// Counts frames where the wheels are driven but the image does not move
+static void check_stall(camera_fb_t *fb) {
+    static uint8_t stall_frames = 0;
+    vo_motion_t motion;
+    esp_err_t res = fb->format == PIXFORMAT_YUV422 ?
+                    vo_process_yuv422(&odometry, fb->buf, fb->width, fb->height, &motion) :
+                    vo_process_rgb565(&odometry, fb->buf, fb->width, fb->height, &motion);
+
+    if(res != ESP_OK || motion.confidence < STALL_MIN_CONFIDENCE) {
+        return;
+    }
+
+    // A shorter period sees less motion per frame and more frames per second
+    float period_scale = (float)control_period_ms / CONTROL_PERIOD_MS;
+    float moved = fabsf(motion.dx) + fabsf(motion.dy) + fabsf(motion.scale) * VO_W / 2;
+    int driving = motor_left.duty > 0 || motor_right.duty > 0;
+
+    if(driving && moved < STALL_MAX_MOTION_PX * period_scale) {
+        if(++stall_frames >= STALL_FRAMES / period_scale) {
+            ESP_LOGW(TAG, "Stall detected, stopping car");
+            car_stop();
+            stall_frames = 0;
+            stall_hold = STALL_HOLD_FRAMES / period_scale;
+        }
+    } else {
+        stall_frames = 0;
+    }
+}
+
+// One control period: capture, track, steer, publish the frame. The camera
+// governor decides which periods capture and at what resolution.
+static void control_job(void *arg) {
+    static navigator_t nav = { 0 };
+    static nav_gains_t gains;
+
+    if(param_store_version() != params_version) {
+        params_version = param_store_snapshot(&params);
+        color_stream_set_thresholds(params.min_s, params.min_v, params.min_area);
+        gains.base_speed = params.base_speed;
+        gains.kp = params.kp;
+        gains.kd_heading = params.kd_heading;
+        gains.center_x = params.center_x;
+        // The tape "blob" has no size to judge distance by
+        gains.standoff_width = params.vision_mode == VISION_LINE ? 0 : params.standoff_width;
+        gains.ttc_slow_s = params.ttc_slow_s;
+
+        // Line mode runs at the sensor's frame rate, blob mode at the control rate
+        uint32_t period_ms = params.vision_mode == VISION_LINE ? LINE_PERIOD_MS : CONTROL_PERIOD_MS;
+        if(period_ms != control_period_ms && control_rt != NULL &&
+           rt_task_set_period(control_rt, period_ms, 0) == ESP_OK) {
+            control_period_ms = period_ms;
+        }
+    }
+
+    if(!camera_governor_should_capture()) { return; }
+
+    trace_begin(TRACE_CONTROL);
+    trace_begin(TRACE_CAPTURE);
+    camera_fb_t* fb = camera_capture_decimated(camera_governor_decimation());
+    trace_end(TRACE_CAPTURE);
+    if(!fb) {
+        // A failed capture is a lost target: the navigator stops after
+        // NAV_LOST_FRAMES and the governor does not stay stuck in its mode
+        nav_command_t cmd;
+        if(navigator_update(&nav, NULL, NULL, &gains, &cmd) == NAV_STOP) car_stop();
+        camera_governor_update(0, motor_left.duty > 0 || motor_right.duty > 0);
+        trace_end(TRACE_CONTROL);
+        return;
+    }
+
+    color_blob_t blob;
+    line_fit_t fit = { 0 };
+    uint32_t span_count = 0;
+    uint8_t span_overflow = 0;
+    esp_err_t res;
+
+    trace_begin(TRACE_VISION);
+    if(params.vision_mode == VISION_LINE) {
+        // Same blob form: the centroid is the look-ahead point on the tape.
+        // Any other format fails, and the navigator stops as on a lost line.
+        color_format_t format = fb->format == PIXFORMAT_YUV422 ? COLOR_FORMAT_YUV422 : COLOR_FORMAT_RGB565;
+        res = fb->format == PIXFORMAT_RGB565 || fb->format == PIXFORMAT_YUV422 ?
+              line_follower_process(fb->buf, fb->width, fb->height, format, &TAPE_COLOR, &line_config, &blob, &fit) :
+              ESP_ERR_NOT_SUPPORTED;
+    } else {
+        res = compute_blob_with_mask(fb, &TARGET_COLOR, &blob, mask_spans, WEB_STREAMER_MAX_SPANS,
+                                     &span_count, &span_overflow);
+    }
+    web_streamer_update_mask(mask_spans, span_count, span_overflow, fb->width, fb->height);
+
+    // Before the overlay is drawn, so the box does not look like motion
+    check_stall(fb);
+    trace_end(TRACE_VISION);
+
+    if(res == ESP_OK) {
+        // Visualization: Draw GREEN box (0x07E0) around target
+        int w = blob.bottom_right.x - blob.top_left.x;
+        int h = blob.bottom_right.y - blob.top_left.y;
+
+        trace_begin(TRACE_OVERLAY);
+        web_streamer_draw_overlay(fb,
+                                  blob.top_left.x, blob.top_left.y, w, h, // Box coords
+                                  blob.centroid.x, blob.centroid.y,       // Center coords
+                                  BOX_COLOR, CENTER_COLOR);
+        trace_end(TRACE_OVERLAY);
+    }
+
+    // Motor Logic
+    trace_begin(TRACE_MOTOR_UPDATE);
+    nav_command_t cmd;
+    nav_frame_t frame = {
+        .width = fb->width,
+        .height = fb->height,
+        .time_us = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec,
+        .heading_rad = fit.heading_rad
+    };
+    nav_action_t action = navigator_update(&nav, res == ESP_OK ? &blob : NULL, &frame, &gains, &cmd);
+
+    // After a stall the navigator would drive straight back into the obstacle
+    int stalled = stall_hold > 0;
+    if(stalled) stall_hold--;
+
+    if(action == NAV_DRIVE && !stalled) {
+        motor_set_dir(&motor_left, FORWARD);
+        motor_set_dir(&motor_right, FORWARD);
+        motor_set_duty(&motor_left, percent_to_duty(cmd.left));
+        motor_set_duty(&motor_right, percent_to_duty(cmd.right));
+    } else if(action == NAV_STOP) {
+        printf("Target lost! Stopping car.\n");
+        car_stop();
+    } else if(action == NAV_ARRIVED && (motor_left.duty > 0 || motor_right.duty > 0)) {
+        printf("Arrived at target. Stopping car.\n");
+        car_stop();
+    }
+    trace_end(TRACE_MOTOR_UPDATE);
+
+    camera_governor_update(detection_confidence(res, &blob, fb), motor_left.duty > 0 || motor_right.duty > 0);
+
+    // 3. Update Stream (Simple one-liner)
+    web_streamer_update_frame(fb);
+
+    camera_release(fb);
+    trace_end(TRACE_CONTROL);
+}
+
+// Failsafe: never keep driving on a steering command that is out of date
+static void control_deadline_miss(void *arg) {
+    car_stop();
+    ESP_LOGW(TAG, "Control deadline missed, motors stopped");
+}
+
+static void monitor_job(void *arg) {
+    rt_task_print_stats();
+    camera_governor_print_stats();
+}
 
 void app_main(void){
+    // Timeline of the pipeline stages, dumped from /trace
+    if(trace_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Event tracer disabled");
+    }
+
     ESP_ERROR_CHECK(motor_driver_init());
-    
+
     // 1. Start Camera
     register_camera(XCLK_FREQ_HZ, PIXFORMAT, FRAMESIZE, QUALITY, COUNT);
-    
+
     // 2. Start Web Streamer (Simple one-liner now!)
     web_streamer_init(WIFI_SSID, WIFI_PASS);
 
+    // 3. Load tuned parameters (NVS is initialized by the web streamer)
+    ESP_ERROR_CHECK(param_store_init());
+
+    const vo_config_t vo_config = VO_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(vo_init(&odometry, &vo_config));
+
+    // 4. Scale resolution, frame rate and CPU clock with the tracking state
+    const camera_governor_config_t governor_config = CAMERA_GOVERNOR_CONFIG_DEFAULT();
+    if(camera_governor_init(&governor_config) != ESP_OK) {
+        ESP_LOGW(TAG, "Camera governor disabled, capturing every period at full size");
+    }
+
     printf("Waiting for system warmup...\n");
     vTaskDelay(pdMS_TO_TICKS(2000));
 
-    // RGB565 Color Definitions
-    const uint16_t COLOR_GREEN = 0x07E0;
-    const uint16_t COLOR_BLUE  = 0x001F;
-
-    uint8_t db = 0;
-
-    while(1){
-        camera_fb_t* fb = camera_capture();
-        if(!fb) { vTaskDelay(1); continue; }
-
-        color_blob_t blob;
-        esp_err_t res = compute_blob(fb, &COLOR_RED, &blob);
-
-        if(res == ESP_OK) { 
-            // Visualization: Draw GREEN box (0x07E0) around target
-            int w = blob.bottom_right.x - blob.top_left.x;
-            int h = blob.bottom_right.y - blob.top_left.y;
-
-            web_streamer_draw_overlay(fb, 
-                                      blob.top_left.x, blob.top_left.y, w, h, // Box coords
-                                      blob.centroid.x, blob.centroid.y,       // Center coords
-                                      COLOR_GREEN, COLOR_BLUE);
-
-            // Motor Logic
-            int error = blob.centroid.x - CENTER_X;
-            float turn_effort = error * KP;
-            
-            float left = BASE_SPEED + turn_effort;
-            float right = BASE_SPEED - turn_effort;
-            
-            if(left > 100) { left = 100; }
-            if(left < 0) { left = 0; }
-            
-            if(right > 100) { right = 100; }
-            if(right < 0) { right = 0; }
-
-            motor_set_dir(&motor_left, FORWARD);
-            motor_set_dir(&motor_right, FORWARD);
-            motor_set_duty(&motor_left, percent_to_duty(left));
-            motor_set_duty(&motor_right, percent_to_duty(right));
-        } else {
-            if(db++ > 10) {
-                printf("Target lost! Stopping car.\n");
-                car_stop();
-                db = 0;
-            }
-            
-        }
-
-        // 3. Update Stream (Simple one-liner)
-        web_streamer_update_frame(fb);
+    const rt_task_config_t control_task = {
+        .name = "control",
+        .job = control_job,
+        .on_deadline_miss = control_deadline_miss,
+        .period_ms = CONTROL_PERIOD_MS,
+        .deadline_ms = CONTROL_DEADLINE_MS,
+        .priority = CONTROL_PRIORITY,
+        .core = CONTROL_CORE,
+        .stack_size = 4096
+    };
+    ESP_ERROR_CHECK(rt_task_create(&control_task, &control_rt));
 
-        esp_camera_fb_return(fb); 
-        vTaskDelay(pdMS_TO_TICKS(20)); 
-    }
-}
\ No newline at end of file
+    const rt_task_config_t monitor_task = {
+        .name = "monitor",
+        .job = monitor_job,
+        .period_ms = MONITOR_PERIOD_MS,
+        .priority = MONITOR_PRIORITY,
+        .core = tskNO_AFFINITY,
+        .stack_size = 3072
+    };
+    ESP_ERROR_CHECK(rt_task_create(&monitor_task, NULL));
+}